@@ -0,0 +1,58 @@
+// Arduino core subset for the native (host) build - see bench/README.md
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include "WString.h"
+#include "Print.h"
+#include "IPAddress.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+
+#define PROGMEM
+#define F(x) (x)
+#define HIGH 1
+#define LOW  0
+
+using std::min;
+using std::max;
+template<class T, class L, class H> T constrain(T v, L lo, H hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+// stdout; write errors are ignored like a disconnected UART
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t* buf, size_t len) override { return fwrite(buf, 1, len, stdout); }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override { fflush(stdout); }
+    operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+// Time since process start (the host has no boot)
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+extern "C" uint32_t esp_random();
+
+// SNTP isn't emulated; the host clock is already set
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2 = NULL, const char* server3 = NULL);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
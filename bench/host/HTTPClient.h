@@ -0,0 +1,88 @@
+// HTTP/1.1 client with the ESP32 HTTPClient interface the library uses:
+// keep-alive reuse, Content-Length and chunked bodies, collected headers.
+#pragma once
+#include <Arduino.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "WiFiClient.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_STREAM           (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_ENCODING            (-9)
+#define HTTPC_ERROR_STREAM_WRITE        (-10)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+#define HTTPC_DEFAULT_TCP_TIMEOUT (5000)
+
+typedef enum {
+    HTTP_CODE_OK                    = 200,
+    HTTP_CODE_NO_CONTENT            = 204,
+    HTTP_CODE_NOT_MODIFIED          = 304,
+    HTTP_CODE_BAD_REQUEST           = 400,
+    HTTP_CODE_UNAUTHORIZED          = 401,
+    HTTP_CODE_NOT_FOUND             = 404,
+    HTTP_CODE_CONFLICT              = 409,
+    HTTP_CODE_TOO_MANY_REQUESTS     = 429,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+    HTTP_CODE_SERVICE_UNAVAILABLE   = 503
+} t_http_codes;
+
+class HTTPClient {
+public:
+    HTTPClient() {}
+    ~HTTPClient() { if (client_ && !reuse_) client_->stop(); }
+
+    bool begin(WiFiClient& client, const char* url);
+    bool begin(WiFiClient& client, const String& url) { return begin(client, url.c_str()); }
+    bool begin(WiFiClient& client, const String& host, uint16_t port, const String& uri = "/", bool https = false);
+    void end();
+
+    void setReuse(bool reuse) { reuse_ = reuse; }
+    void useHTTP10(bool on) { http10_ = on; }
+    void setConnectTimeout(int32_t ms) { connectTimeout_ = ms; }
+    void setTimeout(uint16_t ms) { timeout_ = ms; }
+
+    void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
+    void collectHeaders(const char* keys[], const size_t count);
+    String header(const char* name);
+    bool hasHeader(const char* name);
+
+    int GET();
+    int POST(uint8_t* payload, size_t size);
+    int POST(const String& payload) { return POST((uint8_t*)payload.c_str(), payload.length()); }
+    int sendRequest(const char* method, const uint8_t* payload, size_t size);
+
+    int getSize() const { return size_; }
+    WiFiClient* getStreamPtr() { return connected() ? client_ : NULL; }
+    WiFiClient& getStream() { return *client_; }
+    bool connected() { return client_ && (client_->available() > 0 || client_->connected()); }
+
+    String getString();
+    int writeToStream(Stream* out);
+
+    static String errorToString(int error);
+
+private:
+    WiFiClient* client_ = NULL;
+    std::string host_, uri_;
+    uint16_t port_ = 80;
+    bool reuse_ = true, http10_ = false;
+    int32_t connectTimeout_ = HTTPC_DEFAULT_TCP_TIMEOUT;
+    uint16_t timeout_ = HTTPC_DEFAULT_TCP_TIMEOUT;
+
+    std::string headers_;                  // extra request header lines
+    std::vector<std::pair<std::string, std::string>> collected_;
+    int size_ = -1;
+    bool chunked_ = false, canReuse_ = false;
+
+    int readHeaders();
+    bool readLine(std::string& out);
+    int readBody(Stream* out, std::string* into);
+};
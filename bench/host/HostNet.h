@@ -0,0 +1,87 @@
+// Host transport behind WiFiClient: real TCP sockets, or an in-process mock
+// origin, both with injectable latency and loss. Only the bench uses this
+// header directly; the library sees plain WiFiClient / HTTPClient.
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One open byte stream (non-blocking reads)
+struct HostConnection {
+    virtual ~HostConnection() {}
+    virtual size_t write(const uint8_t* data, size_t len) = 0;
+    virtual int  available() = 0;                    // bytes readable now
+    virtual int  read(uint8_t* buf, size_t len) = 0; // 0 when nothing is readable
+    virtual int  peek() = 0;                         // -1 when nothing is readable
+    virtual bool open() = 0;                         // peer hasn't closed
+    virtual void close() = 0;
+};
+
+namespace HostNet {
+
+// Applied to every connection WiFiClient opens. Latency delays each response
+// (uniform in [min, max]); a lost exchange closes the socket after the request
+// was written, so the caller sees a transport error like a dropped Wi-Fi frame.
+// dnsMs is paid by every hostname lookup, WiFi.hostByName() or a connect by
+// name; connects to an address skip it. A stalled exchange answers stallMs
+// late on top of the latency, the slow tail that deadlines and hedging handle.
+struct Faults {
+    uint32_t latencyMinMs = 0;
+    uint32_t latencyMaxMs = 0;
+    float    lossPercent = 0;      // per request
+    float    refusePercent = 0;    // per connect
+    uint32_t dnsMs = 0;            // per hostname lookup
+    float    stallPercent = 0;     // per request
+    uint32_t stallMs = 0;
+};
+void   setFaults(const Faults& f);
+Faults faults();
+
+struct Stats {
+    uint32_t connects = 0, refused = 0, lost = 0, lookups = 0, stalled = 0;
+    uint32_t mockRequests = 0;
+    uint64_t bytesOut = 0, bytesIn = 0;
+};
+Stats stats();
+void  resetStats();
+
+// ───── in-process origin
+typedef std::vector<std::pair<std::string, std::string>> HeaderList;
+
+struct MockRequest {
+    std::string method, path, body;
+    HeaderList headers;
+    const std::string* header(const char* name) const;   // case-insensitive, NULL if absent
+};
+
+struct MockResponse {
+    int status = 200;
+    std::string body;
+    HeaderList headers;
+    uint32_t delayMs = 0;    // server-side hold (long-poll), before injected latency
+    bool close = false;      // send Connection: close and drop the socket
+};
+
+typedef std::function<MockResponse(const MockRequest&)> MockHandler;
+
+// Connections to `host` (any port) are answered in-process by handler, which
+// runs on the thread that wrote the request. Pass an empty handler to remove.
+// A mock host resolves to an address of its own in 198.18.0.0/24.
+void setMockHost(const std::string& host, MockHandler handler);
+
+// Used by WiFiClient (host may be a dotted address) and WiFi.hostByName();
+// NULL / false on failure
+std::shared_ptr<HostConnection> open(const char* host, uint16_t port, uint32_t timeoutMs);
+bool resolve(const char* host, uint32_t& addr);   // IPAddress order
+
+// Latency for the next exchange / whether to lose it (draws from the faults)
+uint32_t drawLatency();   // includes a stall if one is drawn
+bool     drawLoss();
+bool     drawRefusal();
+void     countLost();
+void     countBytes(uint64_t out, uint64_t in);
+
+}  // namespace HostNet
@@ -0,0 +1,66 @@
+// Host stand-ins for Print / Stream
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include "WString.h"
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len) {
+        size_t n = 0;
+        while (len-- && write(*buf++)) n++;
+        return n;
+    }
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    virtual void flush() {}
+
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char small[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(small, sizeof(small), fmt, ap);
+        va_end(ap);
+        if (n < 0) return 0;
+        if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, n);
+        std::string big(n + 1, '\0');
+        va_start(ap, fmt);
+        vsnprintf(&big[0], big.size(), fmt, ap);
+        va_end(ap);
+        return write((const uint8_t*)big.data(), n);
+    }
+
+    size_t print(const char* s)   { return write(s); }
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(char c)          { return write((uint8_t)c); }
+    size_t print(int v, int base = 10)           { return print(String((long)v, base)); }
+    size_t print(unsigned v, int base = 10)      { return print(String((unsigned long)v, base)); }
+    size_t print(long v, int base = 10)          { return print(String(v, base)); }
+    size_t print(unsigned long v, int base = 10) { return print(String(v, base)); }
+    size_t print(double v, int digits = 2)       { return print(String(v, digits)); }
+
+    size_t println() { return write((const uint8_t*)"\r\n", 2); }
+    template<class T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    template<class T> size_t println(const T& v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { timeout_ = ms; }
+    unsigned long getTimeout() const { return timeout_; }
+
+    // Blocks until len bytes arrived or the stream timeout passed
+    size_t readBytes(uint8_t* buf, size_t len);
+    size_t readBytes(char* buf, size_t len) { return readBytes((uint8_t*)buf, len); }
+    String readString();
+
+protected:
+    unsigned long timeout_ = 1000;
+    int timedRead();
+};
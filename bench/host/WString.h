@@ -0,0 +1,112 @@
+// Host stand-in for the Arduino String (std::string backed)
+#pragma once
+#include <string>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+class StringSumHelper;
+
+class String {
+public:
+    String(const char* s = "") : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+    String(const String&) = default;
+    String(String&&) = default;
+    explicit String(char c) : s_(1, c) {}
+    explicit String(unsigned char v, unsigned char base = 10) { fromInt(v, base); }
+    explicit String(int v,           unsigned char base = 10) { fromInt(v, base); }
+    explicit String(unsigned v,      unsigned char base = 10) { fromUInt(v, base); }
+    explicit String(long v,          unsigned char base = 10) { fromInt(v, base); }
+    explicit String(unsigned long v, unsigned char base = 10) { fromUInt(v, base); }
+    explicit String(float v,  unsigned int decimals = 2) { fromDouble(v, decimals); }
+    explicit String(double v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+
+    String& operator=(const String&) = default;
+    String& operator=(String&&) = default;
+    String& operator=(const char* s) { s_ = s ? s : ""; return *this; }
+
+    const char* c_str() const { return s_.c_str(); }
+    unsigned length() const { return (unsigned)s_.size(); }
+    bool isEmpty() const { return s_.empty(); }
+    bool reserve(unsigned n) { s_.reserve(n); return true; }
+
+    bool concat(const String& o) { s_ += o.s_; return true; }
+    bool concat(const char* s)   { if (!s) return false; s_ += s; return true; }
+    bool concat(const char* s, unsigned n) { if (!s) return false; s_.append(s, n); return true; }
+    bool concat(char c)          { s_ += c; return true; }
+    template<class T> bool concat(T v) { return concat(String(v)); }
+
+    String& operator+=(const String& o) { concat(o); return *this; }
+    String& operator+=(const char* s)   { concat(s); return *this; }
+    String& operator+=(char c)          { concat(c); return *this; }
+    template<class T> String& operator+=(T v) { concat(v); return *this; }
+
+    char operator[](unsigned i) const { return i < s_.size() ? s_[i] : 0; }
+    char& operator[](unsigned i) { return s_[i]; }
+    char charAt(unsigned i) const { return (*this)[i]; }
+
+    bool equals(const String& o) const { return s_ == o.s_; }
+    bool equalsIgnoreCase(const String& o) const {
+        return s_.size() == o.s_.size() && strncasecmp(s_.c_str(), o.s_.c_str(), s_.size()) == 0;
+    }
+    bool operator==(const String& o) const { return s_ == o.s_; }
+    bool operator==(const char* s) const   { return s_ == (s ? s : ""); }
+    bool operator!=(const String& o) const { return s_ != o.s_; }
+    bool operator!=(const char* s) const   { return !(*this == s); }
+    bool operator<(const String& o) const  { return s_ < o.s_; }
+    bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+    bool endsWith(const String& p) const {
+        return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+    }
+
+    int indexOf(char c, unsigned from = 0) const { return pos(s_.find(c, from)); }
+    int indexOf(const String& p, unsigned from = 0) const { return pos(s_.find(p.s_, from)); }
+    int lastIndexOf(char c) const { return pos(s_.rfind(c)); }
+    String substring(unsigned from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+    String substring(unsigned from, unsigned to) const {
+        if (from > to) { unsigned t = from; from = to; to = t; }
+        if (from >= s_.size()) return String();
+        return String(s_.substr(from, to - from));
+    }
+    void remove(unsigned index) { if (index < s_.size()) s_.erase(index); }
+    void remove(unsigned index, unsigned count) { if (index < s_.size()) s_.erase(index, count); }
+    void trim() {
+        size_t b = s_.find_first_not_of(" \t\r\n");
+        size_t e = s_.find_last_not_of(" \t\r\n");
+        s_ = b == std::string::npos ? std::string() : s_.substr(b, e - b + 1);
+    }
+    void toLowerCase() { for (char& c : s_) if (c >= 'A' && c <= 'Z') c += 'a' - 'A'; }
+    void toUpperCase() { for (char& c : s_) if (c >= 'a' && c <= 'z') c -= 'a' - 'A'; }
+    long  toInt()   const { return atol(s_.c_str()); }
+    float toFloat() const { return (float)atof(s_.c_str()); }
+
+private:
+    std::string s_;
+
+    static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+    void fromInt(long v, unsigned char base) {
+        if (base == 10) { char b[24]; snprintf(b, sizeof(b), "%ld", v); s_ = b; }
+        else if (v < 0) { fromUInt((unsigned long)-v, base); s_.insert(0, "-"); }
+        else fromUInt((unsigned long)v, base);
+    }
+    void fromUInt(unsigned long v, unsigned char base) {
+        char b[72]; char* p = b + sizeof(b); *--p = 0;
+        if (base < 2) base = 10;
+        do { unsigned d = v % base; *--p = (char)(d < 10 ? '0' + d : 'a' + d - 10); v /= base; } while (v);
+        s_ = p;
+    }
+    void fromDouble(double v, unsigned decimals) { char b[48]; snprintf(b, sizeof(b), "%.*f", (int)decimals, v); s_ = b; }
+};
+
+// Result type of operator+, as in the ESP32 core (ArduinoJson adapts both)
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+    StringSumHelper(const char* s) : String(s) {}
+};
+
+inline StringSumHelper operator+(const String& a, const String& b) { StringSumHelper r(a); r += b; return r; }
+inline StringSumHelper operator+(const String& a, const char* b)   { StringSumHelper r(a); r += b; return r; }
+inline StringSumHelper operator+(const char* a, const String& b)   { StringSumHelper r(a); r += b; return r; }
+inline StringSumHelper operator+(const String& a, char c)          { StringSumHelper r(a); r += c; return r; }
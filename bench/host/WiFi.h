@@ -0,0 +1,98 @@
+#pragma once
+#include <Arduino.h>
+#include "WiFiClient.h"
+#include <functional>
+#include <vector>
+
+typedef enum {
+    WL_IDLE_STATUS     = 0,
+    WL_NO_SSID_AVAIL   = 1,
+    WL_CONNECTED       = 3,
+    WL_CONNECT_FAILED  = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED    = 6
+} wl_status_t;
+
+#define WIFI_OFF 0
+#define WIFI_STA 1
+
+// The station events and payloads WiFiLink uses, shaped like the ESP32 core's
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_CONNECTED    = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP       = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP      = 8,
+    ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+enum { WIFI_REASON_AUTH_EXPIRE = 2, WIFI_REASON_ASSOC_LEAVE = 8, WIFI_REASON_BEACON_TIMEOUT = 200, WIFI_REASON_NO_AP_FOUND = 201 };
+
+typedef union {
+    struct { uint8_t ssid[33]; uint8_t ssid_len; uint8_t bssid[6]; uint8_t channel; int authmode; } wifi_sta_connected;
+    struct { uint8_t ssid[33]; uint8_t ssid_len; uint8_t bssid[6]; uint8_t reason; } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+typedef size_t wifi_event_id_t;
+
+// The host network is always up unless a test takes the link down with
+// setStatus() / setLinkDown() to exercise the reconnect path. Status changes
+// raise the station events on the calling thread; begin() (re)associates at
+// once (channel 6, a fixed BSSID) unless the link is held down.
+class WiFiClass {
+public:
+    wl_status_t status() const { return status_; }
+    void setStatus(wl_status_t s) {
+        bool wasUp = status_ == WL_CONNECTED;
+        status_ = s;
+        if (wasUp && s != WL_CONNECTED) {
+            arduino_event_info_t info = {};
+            info.wifi_sta_disconnected.reason = WIFI_REASON_BEACON_TIMEOUT;
+            emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+        } else if (!wasUp && s == WL_CONNECTED) {
+            arduino_event_info_t info = {};
+            static const uint8_t ap[6] = { 0x02, 0, 0, 0, 0, 0x01 };
+            memcpy(info.wifi_sta_connected.bssid, ap, sizeof(ap));
+            info.wifi_sta_connected.channel = 6;
+            emit(ARDUINO_EVENT_WIFI_STA_CONNECTED, info);
+            emit(ARDUINO_EVENT_WIFI_STA_GOT_IP, arduino_event_info_t());
+        }
+    }
+
+    wl_status_t begin(const char*, const char* = NULL, int32_t = 0, const uint8_t* = NULL, bool connect = true) {
+        if (connect && !linkDown_) {
+            status_ = WL_DISCONNECTED;   // (re)association, no disconnect event
+            setStatus(WL_CONNECTED);
+        } else if (connect) {
+            arduino_event_info_t info = {};   // the attempt fails at once
+            info.wifi_sta_disconnected.reason = WIFI_REASON_AUTH_EXPIRE;
+            emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+        }
+        return status_;
+    }
+    bool config(IPAddress, IPAddress, IPAddress, IPAddress = IPAddress(), IPAddress = IPAddress()) { return true; }
+    bool reconnect() { return true; }
+    bool disconnect(bool = false) { return true; }
+    bool mode(int) { return true; }
+    bool setSleep(bool) { return true; }
+    bool setAutoReconnect(bool) { return true; }
+    wifi_event_id_t onEvent(WiFiEventFuncCb cb, arduino_event_id_t = ARDUINO_EVENT_MAX) { handlers_.push_back(cb); return handlers_.size(); }
+    void removeEvent(wifi_event_id_t id) { if (id && id <= handlers_.size()) handlers_[id - 1] = nullptr; }
+    int8_t RSSI() const { return -50; }
+    IPAddress localIP() const { return IPAddress(127, 0, 0, 1); }
+    String SSID() const { return String("host"); }
+    int hostByName(const char* host, IPAddress& result);   // 1 = resolved (HostNet::resolve)
+
+    // Test hook: while down, begin() does not reassociate
+    void setLinkDown(bool down) { linkDown_ = down; if (down) setStatus(WL_CONNECTION_LOST); }
+
+private:
+    void emit(arduino_event_id_t event, const arduino_event_info_t& info) {
+        for (auto& h : handlers_) if (h) h(event, info);
+    }
+
+    wl_status_t status_ = WL_CONNECTED;
+    bool linkDown_ = false;
+    std::vector<WiFiEventFuncCb> handlers_;
+};
+extern WiFiClass WiFi;
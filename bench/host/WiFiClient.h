@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+#include <memory>
+
+struct HostConnection;
+
+class Client : public Stream {
+public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char* host, uint16_t port) = 0;
+    virtual uint8_t connected() = 0;
+    virtual void stop() = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+    using Stream::read;
+    virtual operator bool() = 0;
+};
+
+// TCP client over HostNet (mock origins included). Copies share the socket,
+// like the ESP32 class. Injected latency holds back the response to each
+// request; injected loss closes the socket once the request was sent.
+class WiFiClient : public Client {
+public:
+    WiFiClient();
+    ~WiFiClient();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    int connect(const char* host, uint16_t port, int32_t timeoutMs);
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs);
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override {}
+
+    // Reads whole chunks instead of Stream's byte loop (hides Stream::readBytes)
+    size_t readBytes(uint8_t* buf, size_t len);
+    size_t readBytes(char* buf, size_t len) { return readBytes((uint8_t*)buf, len); }
+
+    uint8_t connected() override;
+    void stop() override;
+    operator bool() override { return connected(); }
+
+    void setNoDelay(bool) {}
+    void setConnectTimeout(int32_t ms) { connectTimeout_ = ms; }
+
+private:
+    std::shared_ptr<HostConnection> conn_;
+    uint32_t holdUntil_ = 0;        // injected latency of the pending response
+    bool awaitingResponse_ = false; // request written, reply not seen yet
+    bool dropReply_ = false;        // injected loss: close once the reply is awaited
+    int32_t connectTimeout_ = 3000;
+
+    bool released();                // past the injected latency
+};
@@ -0,0 +1,2 @@
+// No TLS on the host build; declared so ESPGameAPI.h compiles unchanged
+#pragma once
@@ -0,0 +1,35 @@
+// FreeRTOS subset on std::thread - see bench/host/host_freertos.cpp
+#pragma once
+#include <stdint.h>
+#include <mutex>
+
+typedef int          BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t     TickType_t;
+
+#define pdTRUE   1
+#define pdFALSE  0
+#define pdPASS   pdTRUE
+#define pdFAIL   pdFALSE
+#define portMAX_DELAY        ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS   1
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(ms))
+#define configTICK_RATE_HZ   1000
+#define configMAX_PRIORITIES 25
+#define tskIDLE_PRIORITY     0
+#define tskNO_AFFINITY       0x7FFFFFFF
+
+// Critical sections become a recursive mutex (nesting is legal on the ESP32
+// as well). There are no interrupts to mask on the host.
+struct portMUX_TYPE {
+    std::recursive_mutex m;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux)      ((mux)->m.lock())
+#define portEXIT_CRITICAL(mux)       ((mux)->m.unlock())
+#define portENTER_CRITICAL_ISR(mux)  portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux)   portEXIT_CRITICAL(mux)
+#define taskENTER_CRITICAL(mux)      portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL(mux)       portEXIT_CRITICAL(mux)
+
+BaseType_t xPortGetCoreID();
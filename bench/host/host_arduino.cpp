@@ -0,0 +1,100 @@
+// Arduino core subset for the host build
+#include <Arduino.h>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+
+namespace {
+const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+
+std::mutex rngLock;
+std::mt19937& rng() {
+    static std::mt19937 gen(std::random_device{}());
+    return gen;
+}
+}  // namespace
+
+uint32_t millis() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+
+uint32_t micros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(uint32_t ms) { vTaskDelay(ms); }
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+void yield() { std::this_thread::yield(); }
+
+long random(long max) { return max > 0 ? random(0, max) : 0; }
+
+long random(long min, long max) {
+    if (max <= min) return min;
+    std::lock_guard<std::mutex> l(rngLock);
+    return std::uniform_int_distribution<long>(min, max - 1)(rng());
+}
+
+void randomSeed(unsigned long seed) {
+    std::lock_guard<std::mutex> l(rngLock);
+    rng().seed((std::mt19937::result_type)seed);
+}
+
+extern "C" uint32_t esp_random() {
+    std::lock_guard<std::mutex> l(rngLock);
+    return (uint32_t)rng()();
+}
+
+void configTime(long, int, const char*, const char*, const char*) {}
+
+bool getLocalTime(struct tm* info, uint32_t) {
+    time_t now = time(NULL);
+    return localtime_r(&now, info) != NULL;
+}
+
+// ───── Stream
+int Stream::timedRead() {
+    uint32_t start = millis();
+    do {
+        int c = read();
+        if (c >= 0) return c;
+        vTaskDelay(1);
+    } while (millis() - start < timeout_);
+    return -1;
+}
+
+size_t Stream::readBytes(uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+        int c = timedRead();
+        if (c < 0) break;
+        buf[n++] = (uint8_t)c;
+    }
+    return n;
+}
+
+String Stream::readString() {
+    String out;
+    for (int c = timedRead(); c >= 0; c = timedRead()) out += (char)c;
+    return out;
+}
+
+// ───── esp_err
+extern "C" const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                return "ESP_OK";
+        case ESP_FAIL:              return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+        default:                    return "UNKNOWN ERROR";
+    }
+}
@@ -0,0 +1,211 @@
+// FreeRTOS subset on std::thread / std::condition_variable (1 tick = 1 ms)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+struct HostTask {
+    std::mutex m;
+    std::condition_variable cv;
+    uint32_t notify = 0;
+    std::atomic<bool> deleted{false};
+};
+
+namespace {
+// Thrown from a blocking call of a deleted task; unwinds to the thread root
+struct TaskDeleted {};
+
+thread_local HostTask* currentTask = NULL;
+
+void checkDeleted() {
+    if (currentTask && currentTask->deleted.load()) throw TaskDeleted();
+}
+
+std::chrono::steady_clock::time_point deadline(TickType_t ticks) {
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(ticks);
+}
+
+// Waits on the current task's own condition variable so vTaskDelete() can
+// wake a delayed task; plain threads (the "loop task") just sleep.
+void sleepTicks(TickType_t ticks) {
+    if (!currentTask) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+        return;
+    }
+    std::unique_lock<std::mutex> l(currentTask->m);
+    currentTask->cv.wait_until(l, deadline(ticks), [] { return currentTask->deleted.load(); });
+    l.unlock();
+    checkDeleted();
+}
+}  // namespace
+
+BaseType_t xPortGetCoreID() { return 0; }
+
+// Handles are never freed: another task may still hold one after the thread
+// ended, and tasks are created a handful of times per process.
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg,
+                                   UBaseType_t, TaskHandle_t* out, BaseType_t) {
+    HostTask* t = new HostTask();
+    if (out) *out = t;
+    std::thread([t, fn, arg] {
+        currentTask = t;
+        try { fn(arg); } catch (const TaskDeleted&) {}
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                       UBaseType_t prio, TaskHandle_t* out) {
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, out, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (!task || task == currentTask) {
+        if (currentTask) { currentTask->deleted = true; throw TaskDeleted(); }
+        return;
+    }
+    std::lock_guard<std::mutex> l(task->m);
+    task->deleted = true;
+    task->cv.notify_all();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    checkDeleted();
+    if (ticks) sleepTicks(ticks);
+    else std::this_thread::yield();
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period) {
+    TickType_t next = *previousWake + period;
+    TickType_t now = xTaskGetTickCount();
+    *previousWake = next;
+    if ((int32_t)(next - now) > 0) sleepTicks(next - now);
+    else checkDeleted();
+}
+
+TickType_t xTaskGetTickCount() { return millis(); }
+TaskHandle_t xTaskGetCurrentTaskHandle() { return currentTask; }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (!task) return pdFAIL;
+    std::lock_guard<std::mutex> l(task->m);
+    task->notify++;
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    checkDeleted();
+    HostTask* t = currentTask;
+    if (!t) { vTaskDelay(ticks == portMAX_DELAY ? 1 : ticks); return 0; }
+    std::unique_lock<std::mutex> l(t->m);
+    auto ready = [t] { return t->notify > 0 || t->deleted.load(); };
+    if (ticks == portMAX_DELAY) t->cv.wait(l, ready);
+    else t->cv.wait_until(l, deadline(ticks), ready);
+    l.unlock();
+    checkDeleted();
+    l.lock();
+    uint32_t v = t->notify;
+    if (v) t->notify = clearOnExit ? 0 : v - 1;
+    return v;
+}
+
+// ───── queues
+struct HostQueue {
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<uint8_t> buf;
+    size_t itemSize, length, head = 0, count = 0;
+    HostQueue(size_t len, size_t item) : buf(len * item), itemSize(item), length(len) {}
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return length && itemSize ? new HostQueue(length, itemSize) : NULL;
+}
+
+void vQueueDelete(QueueHandle_t q) { delete q; }
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> l(q->m);
+    auto space = [q] { return q->count < q->length; };
+    if (!space()) {
+        if (!ticks) return pdFALSE;
+        if (ticks == portMAX_DELAY) q->cv.wait(l, space);
+        else if (!q->cv.wait_until(l, deadline(ticks), space)) return pdFALSE;
+    }
+    memcpy(&q->buf[((q->head + q->count) % q->length) * q->itemSize], item, q->itemSize);
+    q->count++;
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void* item, TickType_t ticks) {
+    return xQueueSend(q, item, ticks);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> l(q->m);
+    auto data = [q] { return q->count > 0; };
+    if (!data()) {
+        if (!ticks) return pdFALSE;
+        if (ticks == portMAX_DELAY) q->cv.wait(l, data);
+        else if (!q->cv.wait_until(l, deadline(ticks), data)) return pdFALSE;
+    }
+    memcpy(item, &q->buf[q->head * q->itemSize], q->itemSize);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    std::lock_guard<std::mutex> l(q->m);
+    return (UBaseType_t)q->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q) {
+    std::lock_guard<std::mutex> l(q->m);
+    return (UBaseType_t)(q->length - q->count);
+}
+
+// ───── semaphores (the mutex flavour has no priority inheritance)
+struct HostSemaphore {
+    std::mutex m;
+    std::condition_variable cv;
+    UBaseType_t count, max;
+    HostSemaphore(UBaseType_t mx, UBaseType_t init) : count(init), max(mx) {}
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex()  { return new HostSemaphore(1, 1); }
+SemaphoreHandle_t xSemaphoreCreateBinary() { return new HostSemaphore(1, 0); }
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return new HostSemaphore(maxCount, initialCount);
+}
+void vSemaphoreDelete(SemaphoreHandle_t s) { delete s; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks) {
+    std::unique_lock<std::mutex> l(s->m);
+    auto avail = [s] { return s->count > 0; };
+    if (!avail()) {
+        if (!ticks) return pdFALSE;
+        if (ticks == portMAX_DELAY) s->cv.wait(l, avail);
+        else if (!s->cv.wait_until(l, deadline(ticks), avail)) return pdFALSE;
+    }
+    s->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+    std::lock_guard<std::mutex> l(s->m);
+    if (s->count >= s->max) return pdFALSE;
+    s->count++;
+    s->cv.notify_one();
+    return pdTRUE;
+}
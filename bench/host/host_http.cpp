@@ -0,0 +1,234 @@
+// HTTPClient for the host build (the subset AsyncRequest drives)
+#include <HTTPClient.h>
+#include <strings.h>
+
+bool HTTPClient::begin(WiFiClient& client, const char* url) {
+    std::string u(url ? url : "");
+    size_t scheme = u.find("://");
+    bool https = scheme != std::string::npos && strncasecmp(u.c_str(), "https", 5) == 0;
+    size_t hostStart = scheme == std::string::npos ? 0 : scheme + 3;
+    size_t path = u.find('/', hostStart);
+    std::string hostport = u.substr(hostStart, path == std::string::npos ? std::string::npos : path - hostStart);
+    size_t colon = hostport.find(':');
+    std::string host = hostport.substr(0, colon);
+    uint16_t port = colon == std::string::npos ? (https ? 443 : 80) : (uint16_t)atoi(hostport.c_str() + colon + 1);
+    if (host.empty()) return false;
+    return begin(client, String(host.c_str()), port, String(path == std::string::npos ? "/" : u.c_str() + path), https);
+}
+
+bool HTTPClient::begin(WiFiClient& client, const String& host, uint16_t port, const String& uri, bool) {
+    // A socket to another origin can't be reused
+    if (client_ && (client_ != &client || host_ != host.c_str() || port != port_)) client_->stop();
+    client_ = &client;
+    host_ = host.c_str();
+    port_ = port;
+    uri_ = uri.c_str();
+    headers_.clear();
+    size_ = -1;
+    chunked_ = canReuse_ = false;
+    for (auto& h : collected_) h.second.clear();
+    return true;
+}
+
+void HTTPClient::end() {
+    if (!client_) return;
+    if (!reuse_ || !canReuse_) {
+        client_->stop();
+    } else {
+        // Unread body bytes would be taken for the next response
+        uint8_t scratch[256];
+        while (client_->available() > 0 && client_->read(scratch, sizeof(scratch)) > 0) {}
+    }
+}
+
+void HTTPClient::addHeader(const String& name, const String& value, bool first, bool) {
+    std::string line = std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+    if (first) headers_.insert(0, line);
+    else headers_ += line;
+}
+
+void HTTPClient::collectHeaders(const char* keys[], const size_t count) {
+    collected_.clear();
+    for (size_t i = 0; i < count; i++) collected_.push_back(std::make_pair(std::string(keys[i]), std::string()));
+}
+
+String HTTPClient::header(const char* name) {
+    for (const auto& h : collected_) {
+        if (strcasecmp(h.first.c_str(), name) == 0) return String(h.second);
+    }
+    return String();
+}
+
+bool HTTPClient::hasHeader(const char* name) {
+    for (const auto& h : collected_) {
+        if (strcasecmp(h.first.c_str(), name) == 0) return !h.second.empty();
+    }
+    return false;
+}
+
+int HTTPClient::GET() { return sendRequest("GET", NULL, 0); }
+int HTTPClient::POST(uint8_t* payload, size_t size) { return sendRequest("POST", payload, size); }
+
+int HTTPClient::sendRequest(const char* method, const uint8_t* payload, size_t size) {
+    if (!client_) return HTTPC_ERROR_NOT_CONNECTED;
+    if (!client_->connected()) {
+        client_->setConnectTimeout(connectTimeout_);
+        if (!client_->connect(host_.c_str(), port_)) return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    client_->setTimeout(timeout_);
+
+    std::string req;
+    req.reserve(160 + headers_.size());
+    req.append(method).append(" ").append(uri_).append(http10_ ? " HTTP/1.0\r\nHost: " : " HTTP/1.1\r\nHost: ").append(host_);
+    if (port_ != 80 && port_ != 443) req.append(":").append(std::to_string(port_));
+    req.append("\r\nUser-Agent: ESP32HTTPClient\r\nConnection: ").append(reuse_ && !http10_ ? "keep-alive" : "close");
+    if (payload || size || strcmp(method, "POST") == 0) req.append("\r\nContent-Length: ").append(std::to_string(size));
+    req.append("\r\n").append(headers_).append("\r\n");
+    if (client_->write((const uint8_t*)req.data(), req.size()) != req.size()) {
+        client_->stop();
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+    if (size && client_->write(payload, size) != size) {
+        client_->stop();
+        return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    }
+    return readHeaders();
+}
+
+// One header line; false on timeout or a dropped connection
+bool HTTPClient::readLine(std::string& out) {
+    out.clear();
+    uint32_t last = millis();
+    for (;;) {
+        int c = client_->read();
+        if (c < 0) {
+            if (!client_->connected() || millis() - last > timeout_) return false;
+            vTaskDelay(1);
+            continue;
+        }
+        last = millis();
+        if (c == '\n') {
+            if (!out.empty() && out[out.size() - 1] == '\r') out.erase(out.size() - 1);
+            return true;
+        }
+        if (out.size() < 1024) out.push_back((char)c);
+    }
+}
+
+int HTTPClient::readHeaders() {
+    std::string line;
+    int code = 0;
+    uint32_t start = millis();
+    while (!code) {
+        if (!readLine(line)) {
+            bool timedOut = client_->connected();
+            client_->stop();
+            return timedOut ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+        }
+        if (line.compare(0, 5, "HTTP/") != 0) {
+            if (millis() - start > timeout_) { client_->stop(); return HTTPC_ERROR_READ_TIMEOUT; }
+            continue;
+        }
+        size_t sp = line.find(' ');
+        code = sp == std::string::npos ? 0 : atoi(line.c_str() + sp + 1);
+        canReuse_ = line.compare(0, 8, "HTTP/1.1") == 0 && reuse_ && !http10_;
+        if (code == 100) code = 0;   // skip interim responses
+    }
+    for (;;) {
+        if (!readLine(line)) { client_->stop(); return HTTPC_ERROR_CONNECTION_LOST; }
+        if (line.empty()) break;
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = line.substr(0, colon);
+        size_t v = line.find_first_not_of(' ', colon + 1);
+        std::string value = v == std::string::npos ? std::string() : line.substr(v);
+        if (strcasecmp(name.c_str(), "Content-Length") == 0) size_ = atoi(value.c_str());
+        else if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0) chunked_ = strcasestr(value.c_str(), "chunked") != NULL;
+        else if (strcasecmp(name.c_str(), "Connection") == 0 && strncasecmp(value.c_str(), "close", 5) == 0) canReuse_ = false;
+        for (auto& h : collected_) {
+            if (strcasecmp(h.first.c_str(), name.c_str()) == 0) h.second = value;
+        }
+    }
+    // Without a length the body runs until the server closes
+    if (size_ < 0 && !chunked_) canReuse_ = false;
+    return code;
+}
+
+// Body to a stream or string; bytes delivered or a negative error
+int HTTPClient::readBody(Stream* out, std::string* into) {
+    if (!client_) return HTTPC_ERROR_NOT_CONNECTED;
+    uint8_t buf[512];
+    int total = 0;
+    auto pump = [&](size_t want) -> bool {   // want == 0: until EOF
+        uint32_t last = millis();
+        for (;;) {
+            size_t ask = want ? std::min(want, sizeof(buf)) : sizeof(buf);
+            int n = client_->read(buf, ask);
+            if (n <= 0) {
+                if (!client_->connected()) return want == 0;
+                if (millis() - last > timeout_) return false;
+                vTaskDelay(1);
+                continue;
+            }
+            last = millis();
+            if (out && out->write(buf, n) != (size_t)n) return false;
+            if (into) into->append((const char*)buf, n);
+            total += n;
+            if (want) { want -= n; if (!want) return true; }
+        }
+    };
+    bool ok;
+    if (chunked_) {
+        std::string line;
+        ok = true;
+        for (;;) {
+            if (!readLine(line)) { ok = false; break; }
+            size_t n = strtoul(line.c_str(), NULL, 16);
+            if (!n) {
+                do { if (!readLine(line)) { ok = false; break; } } while (!line.empty());
+                break;
+            }
+            if (!pump(n) || !readLine(line)) { ok = false; break; }
+        }
+    } else if (size_ > 0) {
+        ok = pump((size_t)size_);
+    } else if (size_ == 0) {
+        ok = true;
+    } else {
+        ok = pump(0);
+    }
+    if (!ok) {
+        canReuse_ = false;
+        return total ? total : HTTPC_ERROR_CONNECTION_LOST;
+    }
+    return total;
+}
+
+String HTTPClient::getString() {
+    std::string body;
+    if (size_ > 0) body.reserve(size_);
+    readBody(NULL, &body);
+    return String(body);
+}
+
+int HTTPClient::writeToStream(Stream* out) {
+    if (!out) return HTTPC_ERROR_NO_STREAM;
+    return readBody(out, NULL);
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED:  return "connection refused";
+        case HTTPC_ERROR_SEND_HEADER_FAILED:  return "send header failed";
+        case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+        case HTTPC_ERROR_NOT_CONNECTED:       return "not connected";
+        case HTTPC_ERROR_CONNECTION_LOST:     return "connection lost";
+        case HTTPC_ERROR_NO_STREAM:           return "no stream";
+        case HTTPC_ERROR_NO_HTTP_SERVER:      return "no HTTP server";
+        case HTTPC_ERROR_TOO_LESS_RAM:        return "too less ram";
+        case HTTPC_ERROR_ENCODING:            return "Transfer-Encoding not supported";
+        case HTTPC_ERROR_STREAM_WRITE:        return "Stream write error";
+        case HTTPC_ERROR_READ_TIMEOUT:        return "read Timeout";
+        default:                              return String();
+    }
+}
@@ -0,0 +1,426 @@
+// HostNet transport, WiFiClient and the WiFi singleton for the host build
+#include "HostNet.h"
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+namespace {
+std::mutex netLock;                              // faults, stats, mock hosts
+HostNet::Faults currentFaults;
+HostNet::Stats currentStats;
+std::map<std::string, HostNet::MockHandler> mockHosts;
+std::map<std::string, uint32_t> mockAddrs;       // mock host -> its 198.18.0.x address
+
+bool draw(float percent) {
+    return percent > 0 && (float)(esp_random() % 10000) < percent * 100.0f;
+}
+
+// ───── real sockets
+class TcpConnection : public HostConnection {
+public:
+    explicit TcpConnection(int fd) : fd_(fd) {}
+    ~TcpConnection() { close(); }
+
+    size_t write(const uint8_t* data, size_t len) override {
+        size_t sent = 0;
+        while (fd_ >= 0 && sent < len) {
+            ssize_t n = ::send(fd_, data + sent, len - sent, MSG_NOSIGNAL);
+            if (n > 0) { sent += n; continue; }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                pollfd p = { fd_, POLLOUT, 0 };
+                if (::poll(&p, 1, 5000) > 0) continue;
+            }
+            close();
+        }
+        return sent;
+    }
+    int available() override {
+        int n = 0;
+        if (fd_ < 0 || ioctl(fd_, FIONREAD, &n) < 0) return 0;
+        return n;
+    }
+    int read(uint8_t* buf, size_t len) override {
+        if (fd_ < 0) return 0;
+        ssize_t n = ::recv(fd_, buf, len, MSG_DONTWAIT);
+        if (n == 0) { eof_ = true; return 0; }
+        return n > 0 ? (int)n : 0;
+    }
+    int peek() override {
+        uint8_t c;
+        if (fd_ < 0 || ::recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT) != 1) return -1;
+        return c;
+    }
+    bool open() override {
+        if (fd_ < 0 || eof_) return false;
+        uint8_t c;
+        ssize_t n = ::recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n == 0) eof_ = true;
+        return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+    }
+    void close() override {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    static int dial(const char* host, uint16_t port, uint32_t timeoutMs) {
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = NULL;
+        char portStr[8];
+        snprintf(portStr, sizeof(portStr), "%u", (unsigned)port);
+        if (getaddrinfo(host, portStr, &hints, &res) != 0) return -1;
+        int fd = -1;
+        for (addrinfo* a = res; a && fd < 0; a = a->ai_next) {
+            fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd < 0) continue;
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            int rc = ::connect(fd, a->ai_addr, a->ai_addrlen);
+            if (rc < 0 && errno == EINPROGRESS) {
+                pollfd p = { fd, POLLOUT, 0 };
+                int err = 0;
+                socklen_t len = sizeof(err);
+                rc = (::poll(&p, 1, (int)timeoutMs) == 1 &&
+                      getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) ? 0 : -1;
+            }
+            if (rc < 0) { ::close(fd); fd = -1; }
+        }
+        freeaddrinfo(res);
+        if (fd >= 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        return fd;
+    }
+
+private:
+    int fd_;
+    bool eof_ = false;
+};
+
+// ───── in-process origin: parses HTTP/1.1 requests, queues serialized replies
+class MockConnection : public HostConnection {
+public:
+    explicit MockConnection(HostNet::MockHandler h) : handler_(h) {}
+
+    size_t write(const uint8_t* data, size_t len) override {
+        if (!open_) return 0;
+        in_.append((const char*)data, len);
+        while (parseOne()) {}
+        return len;
+    }
+    int available() override {
+        uint32_t now = millis();
+        size_t n = 0;
+        for (const Reply& r : out_) {
+            if ((int32_t)(now - r.readyAt) < 0) break;
+            n += r.bytes.size() - (&r == &out_.front() ? readPos_ : 0);
+        }
+        return (int)n;
+    }
+    int read(uint8_t* buf, size_t len) override {
+        size_t n = 0;
+        uint32_t now = millis();
+        while (n < len && !out_.empty() && (int32_t)(now - out_.front().readyAt) >= 0) {
+            Reply& r = out_.front();
+            size_t take = std::min(len - n, r.bytes.size() - readPos_);
+            memcpy(buf + n, r.bytes.data() + readPos_, take);
+            n += take;
+            readPos_ += take;
+            if (readPos_ == r.bytes.size()) {
+                if (r.closeAfter) open_ = false;
+                out_.pop_front();
+                readPos_ = 0;
+            }
+        }
+        return (int)n;
+    }
+    int peek() override {
+        if (out_.empty() || (int32_t)(millis() - out_.front().readyAt) < 0) return -1;
+        return (uint8_t)out_.front().bytes[readPos_];
+    }
+    bool open() override { return open_; }
+    void close() override { open_ = false; out_.clear(); in_.clear(); readPos_ = 0; }
+
+private:
+    struct Reply { uint32_t readyAt; std::string bytes; bool closeAfter; };
+    HostNet::MockHandler handler_;
+    std::string in_;
+    std::deque<Reply> out_;
+    size_t readPos_ = 0;
+    bool open_ = true;
+
+    bool parseOne() {
+        size_t end = in_.find("\r\n\r\n");
+        if (end == std::string::npos) return false;
+        HostNet::MockRequest req;
+        size_t lineEnd = in_.find("\r\n");
+        std::string line = in_.substr(0, lineEnd);
+        size_t sp1 = line.find(' '), sp2 = line.rfind(' ');
+        if (sp1 == std::string::npos || sp2 <= sp1) { close(); return false; }
+        req.method = line.substr(0, sp1);
+        req.path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        bool http10 = line.compare(sp2 + 1, 8, "HTTP/1.0") == 0;
+        size_t contentLength = 0;
+        bool clientClose = http10;
+        for (size_t p = lineEnd + 2; p < end;) {
+            size_t e = in_.find("\r\n", p);
+            std::string h = in_.substr(p, e - p);
+            p = e + 2;
+            size_t colon = h.find(':');
+            if (colon == std::string::npos) continue;
+            size_t v = h.find_first_not_of(' ', colon + 1);
+            req.headers.push_back(std::make_pair(h.substr(0, colon), v == std::string::npos ? "" : h.substr(v)));
+            const std::string& name = req.headers.back().first;
+            const std::string& value = req.headers.back().second;
+            if (strcasecmp(name.c_str(), "Content-Length") == 0) contentLength = strtoul(value.c_str(), NULL, 10);
+            if (strcasecmp(name.c_str(), "Connection") == 0) clientClose = strncasecmp(value.c_str(), "close", 5) == 0;
+        }
+        if (in_.size() < end + 4 + contentLength) return false;
+        req.body = in_.substr(end + 4, contentLength);
+        in_.erase(0, end + 4 + contentLength);
+
+        HostNet::MockResponse res = handler_(req);
+        {
+            std::lock_guard<std::mutex> l(netLock);
+            currentStats.mockRequests++;
+        }
+        bool closeAfter = res.close || clientClose;
+        char head[96];
+        snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Length: %u\r\n", res.status,
+                 res.status < 300 ? "OK" : res.status < 400 ? "Not Modified" : "Error", (unsigned)res.body.size());
+        std::string bytes = head;
+        for (const auto& h : res.headers) bytes.append(h.first).append(": ").append(h.second).append("\r\n");
+        bytes.append(closeAfter ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n");
+        bytes.append(res.body);
+        out_.push_back(Reply{ millis() + res.delayMs, bytes, closeAfter });
+        return true;
+    }
+};
+}  // namespace
+
+// ───── HostNet
+namespace HostNet {
+
+void setFaults(const Faults& f) { std::lock_guard<std::mutex> l(netLock); currentFaults = f; }
+Faults faults() { std::lock_guard<std::mutex> l(netLock); return currentFaults; }
+Stats stats() { std::lock_guard<std::mutex> l(netLock); return currentStats; }
+void resetStats() { std::lock_guard<std::mutex> l(netLock); currentStats = Stats(); }
+
+const std::string* MockRequest::header(const char* name) const {
+    for (const auto& h : headers) {
+        if (strcasecmp(h.first.c_str(), name) == 0) return &h.second;
+    }
+    return NULL;
+}
+
+void setMockHost(const std::string& host, MockHandler handler) {
+    std::lock_guard<std::mutex> l(netLock);
+    if (handler) {
+        mockHosts[host] = handler;
+        if (!mockAddrs.count(host)) mockAddrs[host] = IPAddress(198, 18, 0, (uint8_t)(mockAddrs.size() + 1));
+    } else {
+        mockHosts.erase(host);
+    }
+}
+
+// Pays the injected lookup time for a hostname; addresses are free
+static bool lookupDelay(const char* host) {
+    IPAddress literal;
+    if (literal.fromString(host)) return false;
+    uint32_t ms;
+    {
+        std::lock_guard<std::mutex> l(netLock);
+        currentStats.lookups++;
+        ms = currentFaults.dnsMs;
+    }
+    if (ms) delay(ms);
+    return true;
+}
+
+bool resolve(const char* host, uint32_t& addr) {
+    IPAddress literal;
+    if (literal.fromString(host)) { addr = literal; return true; }
+    lookupDelay(host);
+    {
+        std::lock_guard<std::mutex> l(netLock);
+        auto it = mockAddrs.find(host);
+        if (it != mockAddrs.end() && mockHosts.count(host)) { addr = it->second; return true; }
+    }
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = NULL;
+    if (getaddrinfo(host, NULL, &hints, &res) != 0 || !res) return false;
+    addr = ((sockaddr_in*)res->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(res);
+    return true;
+}
+
+std::shared_ptr<HostConnection> open(const char* host, uint16_t port, uint32_t timeoutMs) {
+    bool byName = lookupDelay(host);
+    MockHandler mock;
+    {
+        std::lock_guard<std::mutex> l(netLock);
+        currentStats.connects++;
+        auto it = mockHosts.find(host);
+        if (it != mockHosts.end()) mock = it->second;
+        for (auto a = mockAddrs.begin(); !byName && !mock && a != mockAddrs.end(); ++a) {
+            if (IPAddress(a->second).toString() == host && mockHosts.count(a->first)) mock = mockHosts[a->first];
+        }
+    }
+    if (mock) return std::make_shared<MockConnection>(mock);
+    int fd = TcpConnection::dial(host, port, timeoutMs);
+    if (fd < 0) return NULL;
+    return std::make_shared<TcpConnection>(fd);
+}
+
+uint32_t drawLatency() {
+    Faults f = faults();
+    uint32_t ms = f.latencyMinMs;
+    if (f.latencyMaxMs > f.latencyMinMs) ms += esp_random() % (f.latencyMaxMs - f.latencyMinMs + 1);
+    if (draw(f.stallPercent)) {
+        std::lock_guard<std::mutex> l(netLock);
+        currentStats.stalled++;
+        ms += f.stallMs;
+    }
+    return ms;
+}
+
+bool drawLoss()    { return draw(faults().lossPercent); }
+
+bool drawRefusal() {
+    if (!draw(faults().refusePercent)) return false;
+    std::lock_guard<std::mutex> l(netLock);
+    currentStats.refused++;
+    return true;
+}
+
+void countLost() { std::lock_guard<std::mutex> l(netLock); currentStats.lost++; }
+
+void countBytes(uint64_t out, uint64_t in) {
+    std::lock_guard<std::mutex> l(netLock);
+    currentStats.bytesOut += out;
+    currentStats.bytesIn += in;
+}
+
+}  // namespace HostNet
+
+// ───── WiFiClient
+WiFiClient::WiFiClient() {}
+WiFiClient::~WiFiClient() {}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+    return connect(ip.toString().c_str(), port, timeoutMs);
+}
+
+int WiFiClass::hostByName(const char* host, IPAddress& result) {
+    uint32_t addr = 0;
+    if (!HostNet::resolve(host, addr)) return 0;
+    result = IPAddress(addr);
+    return 1;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    return connect(host, port, connectTimeout_);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    stop();
+    if (HostNet::drawRefusal()) return 0;
+    conn_ = HostNet::open(host, port, timeoutMs > 0 ? (uint32_t)timeoutMs : 3000);
+    awaitingResponse_ = dropReply_ = false;
+    return conn_ ? 1 : 0;
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+    if (!conn_ || !conn_->open()) return 0;
+    if (!awaitingResponse_) {
+        // First bytes of a new exchange: decide its fate once. A lost one
+        // still reaches the server; the reply never arrives.
+        dropReply_ = HostNet::drawLoss();
+        if (dropReply_) HostNet::countLost();
+        holdUntil_ = millis() + HostNet::drawLatency();
+        awaitingResponse_ = true;
+    }
+    size_t n = conn_->write(buf, size);
+    HostNet::countBytes(n, 0);
+    return n;
+}
+
+bool WiFiClient::released() {
+    if (!awaitingResponse_) return true;
+    if (dropReply_) { conn_->close(); dropReply_ = false; return false; }
+    return (int32_t)(millis() - holdUntil_) >= 0;
+}
+
+int WiFiClient::available() {
+    if (!conn_ || !released()) return 0;
+    int n = conn_->available();
+    if (n > 0) awaitingResponse_ = false;
+    return n;
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+    if (!conn_ || !released()) return 0;
+    int n = conn_->read(buf, size);
+    if (n > 0) { awaitingResponse_ = false; HostNet::countBytes(0, n); }
+    return n;
+}
+
+int WiFiClient::peek() {
+    return conn_ && released() ? conn_->peek() : -1;
+}
+
+size_t WiFiClient::readBytes(uint8_t* buf, size_t len) {
+    size_t n = 0;
+    uint32_t start = millis();
+    while (n < len) {
+        int got = read(buf + n, len - n);
+        if (got > 0) { n += got; continue; }
+        if (!connected() || millis() - start >= timeout_) break;
+        vTaskDelay(1);
+    }
+    return n;
+}
+
+uint8_t WiFiClient::connected() {
+    if (!conn_ || !released()) return conn_ && conn_->open();
+    // Held (latency) or buffered replies keep the socket "connected"
+    if (conn_->open()) return 1;
+    return conn_->available() > 0;
+}
+
+void WiFiClient::stop() {
+    if (conn_) conn_->close();
+    conn_.reset();
+    awaitingResponse_ = dropReply_ = false;
+}
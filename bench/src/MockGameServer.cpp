@@ -0,0 +1,132 @@
+#include "MockGameServer.h"
+#include <Arduino.h>
+#include "ESPGameAPI.h"
+
+static const char* const MOCK_TOKEN = "mock-token";
+
+static void putI32(std::string& out, int32_t v) {
+    uint32_t u = static_cast<uint32_t>(v);
+    out.push_back(static_cast<char>(u >> 24));
+    out.push_back(static_cast<char>(u >> 16));
+    out.push_back(static_cast<char>(u >> 8));
+    out.push_back(static_cast<char>(u));
+}
+
+// [count][id][i32 milli] ×2, then [count][uid_len][uid][type] (see PollDecoder)
+std::string MockGameServer::pollFrame(uint32_t version, uint8_t production, uint8_t consumption, uint8_t buildings) {
+    std::string out;
+    out.push_back(static_cast<char>(production));
+    for (uint8_t i = 0; i < production; i++) {
+        out.push_back(static_cast<char>(i + 1));
+        putI32(out, static_cast<int32_t>((version * 37 + i * 211) % 5000) - 500);   // some negative
+    }
+    out.push_back(static_cast<char>(consumption));
+    for (uint8_t i = 0; i < consumption; i++) {
+        out.push_back(static_cast<char>(i + 1));
+        putI32(out, static_cast<int32_t>(1000 + (version * 53 + i * 97) % 4000));
+    }
+    out.push_back(static_cast<char>(buildings));
+    for (uint8_t i = 0; i < buildings; i++) {
+        char uid[24];
+        int n = snprintf(uid, sizeof(uid), "04a1b2c3d4e5%02x", i);
+        out.push_back(static_cast<char>(n));
+        out.append(uid, n);
+        out.push_back(static_cast<char>(i % 4));
+    }
+    return out;
+}
+
+void MockGameServer::install(const std::string& host) {
+    HostNet::setMockHost(host, [this](const HostNet::MockRequest& req) { return handle(req); });
+}
+
+HostNet::MockResponse MockGameServer::handle(const HostNet::MockRequest& req) {
+    HostNet::MockResponse res;
+    res.close = cfg.http10;
+    size_t q = req.path.find('?');
+    std::string path = req.path.substr(0, q);
+    std::string query = q == std::string::npos ? std::string() : req.path.substr(q + 1);
+
+    if (path == "/coreapi/login") {
+        count.login++;
+        res.body = std::string("{\"token\":\"") + MOCK_TOKEN + "\"}";
+        res.headers.push_back(std::make_pair("Content-Type", "application/json"));
+        return res;
+    }
+
+    const std::string* auth = req.header("Authorization");
+    if (!auth || *auth != std::string("Bearer ") + MOCK_TOKEN) {
+        count.unauthorized++;
+        res.status = 401;
+        return res;
+    }
+
+    if (path == "/coreapi/register") {
+        count.registered++;
+        res.body = std::string("\x01\x02ok", 4);
+        if (cfg.compact) res.body.push_back(static_cast<char>(PROTOCOL_VERSION_COMPACT));
+        return res;
+    }
+
+    if (path == "/coreapi/poll_binary") {
+        count.polls++;
+        uint32_t now = millis();
+        uint32_t v = version(now);
+        char etag[24];
+        snprintf(etag, sizeof(etag), "\"v%u\"", (unsigned)v);
+        const std::string* seen = req.header("If-None-Match");
+        if (seen && *seen == etag) {
+            unsigned long waitS = query.compare(0, 5, "wait=") == 0 ? strtoul(query.c_str() + 5, NULL, 10) : 0;
+            uint32_t untilChange = (v + 1) * cfg.changeEveryMs - now;
+            if (waitS && untilChange <= waitS * 1000) {
+                // Held until the next version, then answered with it
+                count.held++;
+                res.delayMs = untilChange;
+                v++;
+                snprintf(etag, sizeof(etag), "\"v%u\"", (unsigned)v);
+            } else {
+                count.notModified++;
+                if (waitS) res.delayMs = waitS * 1000;
+                res.status = 304;
+                res.headers.push_back(std::make_pair("ETag", etag));
+                return res;
+            }
+        }
+        res.headers.push_back(std::make_pair("ETag", etag));
+        res.body = pollFrame(v, cfg.production, cfg.consumption, cfg.buildings);
+        return res;
+    }
+
+    if (path == "/coreapi/prod_vals") {
+        res.body.push_back(static_cast<char>(cfg.production));
+        for (uint8_t i = 0; i < cfg.production; i++) {
+            res.body.push_back(static_cast<char>(i + 1));
+            putI32(res.body, -2000);
+            putI32(res.body, 10000 + i * 1000);
+        }
+        return res;
+    }
+
+    if (path == "/coreapi/cons_vals") {
+        res.body.push_back(static_cast<char>(cfg.consumption));
+        for (uint8_t i = 0; i < cfg.consumption; i++) {
+            res.body.push_back(static_cast<char>(i + 1));
+            putI32(res.body, 1500 + i * 250);
+        }
+        return res;
+    }
+
+    if (path == "/coreapi/post_vals" || path == "/coreapi/post_vals_batch") {
+        count.posts++;
+        return res;
+    }
+
+    if (path == "/coreapi/prod_connected" || path == "/coreapi/cons_connected" || path == "/coreapi/metrics_binary") {
+        count.reports++;
+        return res;
+    }
+
+    count.notFound++;
+    res.status = 404;
+    return res;
+}
@@ -0,0 +1,52 @@
+#ifndef MOCK_GAME_SERVER_H
+#define MOCK_GAME_SERVER_H
+
+#include <HostNet.h>
+#include <atomic>
+#include <string>
+
+// In-process stand-in for the game server's board API, served through a
+// HostNet mock host. The game state is a pure function of time: coefficients
+// change every changeEveryMs (the version is the ETag), so every connection
+// and every forked board sees the same state without shared memory.
+//
+// login          → {"token":"mock-token"} for any credentials
+// register       → [0x01][len][msg] (+ PROTOCOL_VERSION_COMPACT when enabled)
+// poll_binary    → current frame, 304 on a matching If-None-Match; ?wait=
+//                  holds an unchanged poll until the next version
+// prod_vals / cons_vals → ranges / consumption tables
+// post_vals, *_connected, post_vals_batch, metrics_binary → 200, empty
+// anything else (tick_binary) → 404, so the client falls back
+class MockGameServer {
+public:
+    struct Config {
+        uint8_t  production  = 8;      // poll frame sizes
+        uint8_t  consumption = 8;
+        uint8_t  buildings   = 4;
+        uint32_t changeEveryMs = 5000;
+        bool     compact = false;      // advertise the compact protocol
+        bool     http10  = false;      // close after every reply
+    };
+
+    struct Counters {
+        std::atomic<uint32_t> login{0}, registered{0}, polls{0}, notModified{0}, held{0};
+        std::atomic<uint32_t> posts{0}, reports{0}, unauthorized{0}, notFound{0};
+    };
+
+    explicit MockGameServer(const Config& cfg) : cfg(cfg) {}
+
+    void install(const std::string& host = "mock");   // route host through handle()
+    HostNet::MockResponse handle(const HostNet::MockRequest& req);
+
+    const Counters& counters() const { return count; }
+    uint32_t version(uint32_t now_ms) const { return now_ms / (cfg.changeEveryMs ? cfg.changeEveryMs : 1); }
+
+    // Wire format of poll_binary for a version (also used by the decode bench)
+    static std::string pollFrame(uint32_t version, uint8_t production, uint8_t consumption, uint8_t buildings);
+
+private:
+    Config cfg;
+    Counters count;
+};
+
+#endif
@@ -0,0 +1,612 @@
+// Host benchmarks and load generator for ESPGameAPI / AsyncRequest
+//
+//   pio run -e native && .pio/build/native/program [mode] [options]
+//
+// Modes:
+//   decode   PollDecoder throughput and allocations per frame
+//   encode   submitPowerData* / report* cost on the calling (loop) task
+//   load     N simulated boards (forked processes, one AsyncRequest each;
+//            --virtual: one process, virtual boards sharing one connection)
+//   all      decode, encode and a one-board load run (default)
+//
+// Without --url the boards talk to the in-process mock server; with
+// --url http://host:port they stress a real one. Latency and loss are
+// injected under HTTPClient in both cases.
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HostNet.h>
+#include "ESPGameAPI.h"
+#include "WiFiLink.h"
+#include "MockGameServer.h"
+
+#include <new>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ───────────────────────────────────────────── allocation counting
+// Per thread, so worker-task traffic doesn't show up in loop-task numbers
+static thread_local uint64_t tlAllocs = 0;
+static thread_local uint64_t tlAllocBytes = 0;
+
+// The replacement operators below are malloc/free based by design
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(size_t n) {
+    tlAllocs++;
+    tlAllocBytes += n;
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// ───────────────────────────────────────────── options
+struct Options {
+    std::string mode = "all";
+    std::string url;                  // empty = mock server
+    std::string user = "board%u";     // printf format, board number from 1
+    std::string password = "board123";
+    uint32_t iterations = 200000;
+    uint32_t boards = 1;
+    uint32_t seconds = 10;
+    uint32_t updateMs = 3000, pollMs = 5000, tickMs = 10;
+    uint32_t flapMs = 0, outageMs = 1000;   // WiFi drops (0 = never) and their length
+    uint8_t  workers = 3;
+    HostNet::Faults faults;
+    MockGameServer::Config mock;
+    bool adaptive = false, compact = false, push = false, pipeline = false, deferred = false;
+    bool fleet = false;               // --virtual
+};
+
+static void usage() {
+    printf("usage: program [decode|encode|load|all] [options]\n"
+           "  --iterations N      decode/encode loop count (200000)\n"
+           "  --boards N          simulated boards for load (1)\n"
+           "  --virtual           boards share one process and connection pool (SIM_BOARDS)\n"
+           "  --seconds N         load duration (10)\n"
+           "  --url URL           real server instead of the mock (http:// only)\n"
+           "  --user FMT          login name, %%u = board number (board%%u)\n"
+           "  --password P        login password (board123)\n"
+           "  --update-ms N       setUpdateInterval (3000)\n"
+           "  --poll-ms N         setPollInterval (5000)\n"
+           "  --workers N         AsyncRequest workers per board (3)\n"
+           "  --latency MIN[-MAX] injected response latency in ms (0)\n"
+           "  --loss PCT          lost exchanges in %% (0)\n"
+           "  --refuse PCT        refused connects in %% (0)\n"
+           "  --dns-ms N          injected time per hostname lookup (0)\n"
+           "  --stall PCT[,MS]    exchanges answered MS late in %% (0, 3000)\n"
+           "  --flap-ms N[,OUT]   drop WiFi every N ms for OUT ms (off, 1000)\n"
+           "  --frame P,C,B       mock poll frame: production, consumption, buildings (8,8,4)\n"
+           "  --change-ms N       mock coefficient change period (5000)\n"
+           "  --http10            mock closes the connection after every reply\n"
+           "  --adaptive --compact --push --pipeline --deferred   library features\n");
+}
+
+static bool parseArgs(int argc, char** argv, Options& o) {
+    int i = 1;
+    if (i < argc && argv[i][0] != '-') o.mode = argv[i++];
+    for (; i < argc; i++) {
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        auto num = [&](uint32_t& out) { if (!v) return false; out = strtoul(v, NULL, 10); i++; return true; };
+        uint32_t n = 0;
+        if      (a == "--iterations") { if (!num(o.iterations)) return false; }
+        else if (a == "--boards")     { if (!num(o.boards)) return false; }
+        else if (a == "--seconds")    { if (!num(o.seconds)) return false; }
+        else if (a == "--update-ms")  { if (!num(o.updateMs)) return false; }
+        else if (a == "--poll-ms")    { if (!num(o.pollMs)) return false; }
+        else if (a == "--change-ms")  { if (!num(o.mock.changeEveryMs)) return false; }
+        else if (a == "--workers")    { if (!num(n)) return false; o.workers = (uint8_t)n; }
+        else if (a == "--url")        { if (!v) return false; o.url = argv[++i]; }
+        else if (a == "--user")       { if (!v) return false; o.user = argv[++i]; }
+        else if (a == "--password")   { if (!v) return false; o.password = argv[++i]; }
+        else if (a == "--loss")       { if (!v) return false; o.faults.lossPercent = atof(argv[++i]); }
+        else if (a == "--refuse")     { if (!v) return false; o.faults.refusePercent = atof(argv[++i]); }
+        else if (a == "--dns-ms")     { if (!num(o.faults.dnsMs)) return false; }
+        else if (a == "--stall") {
+            if (!v) return false;
+            float pct = 0; unsigned ms = 3000;
+            sscanf(argv[++i], "%f,%u", &pct, &ms);
+            o.faults.stallPercent = pct; o.faults.stallMs = ms;
+        }
+        else if (a == "--flap-ms") {
+            if (!v) return false;
+            unsigned every = 0, out = 1000;
+            sscanf(argv[++i], "%u,%u", &every, &out);
+            o.flapMs = every; o.outageMs = out;
+        }
+        else if (a == "--latency") {
+            if (!v) return false;
+            unsigned lo = 0, hi = 0;
+            int got = sscanf(argv[++i], "%u-%u", &lo, &hi);
+            o.faults.latencyMinMs = lo;
+            o.faults.latencyMaxMs = got == 2 ? hi : lo;
+        } else if (a == "--frame") {
+            if (!v) return false;
+            unsigned p = 0, c = 0, b = 0;
+            if (sscanf(argv[++i], "%u,%u,%u", &p, &c, &b) != 3) return false;
+            o.mock.production = (uint8_t)p; o.mock.consumption = (uint8_t)c; o.mock.buildings = (uint8_t)b;
+        }
+        else if (a == "--http10")   o.mock.http10 = true;
+        else if (a == "--adaptive") o.adaptive = true;
+        else if (a == "--compact")  o.compact = true;
+        else if (a == "--push")     o.push = true;
+        else if (a == "--pipeline") o.pipeline = true;
+        else if (a == "--deferred") o.deferred = true;
+        else if (a == "--virtual")  o.fleet = true;
+        else return false;
+    }
+    o.mock.compact = o.compact;
+    return o.mode == "decode" || o.mode == "encode" || o.mode == "load" || o.mode == "all";
+}
+
+// ───────────────────────────────────────────── timing helpers
+static uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+struct Sample {
+    uint64_t ns = 0, allocs = 0, allocBytes = 0;
+};
+
+template<class F> static Sample measure(uint32_t iterations, F body) {
+    Sample s;
+    uint64_t a0 = tlAllocs, b0 = tlAllocBytes, t0 = nowNs();
+    for (uint32_t i = 0; i < iterations; i++) body(i);
+    s.ns = nowNs() - t0;
+    s.allocs = tlAllocs - a0;
+    s.allocBytes = tlAllocBytes - b0;
+    return s;
+}
+
+static void report(const char* what, uint32_t iterations, const Sample& s, size_t bytesPerOp = 0) {
+    double ns = (double)s.ns / iterations;
+    printf("  %-28s %9.1f ns/op  %6.2f allocs/op  %7.1f B alloc/op", what, ns,
+           (double)s.allocs / iterations, (double)s.allocBytes / iterations);
+    if (bytesPerOp) printf("  %7.1f MB/s", bytesPerOp / ns * 1000.0);
+    printf("\n");
+}
+
+// ───────────────────────────────────────────── decode
+static void benchDecode(const Options& o) {
+    struct Shape { const char* name; uint8_t p, c, b; };
+    const Shape shapes[] = {
+        { "small 2/2/0",   2,  2,  0 },
+        { "typical 8/8/4", 8,  8,  4 },
+        { "full 32/32/16", 32, 32, 16 },
+    };
+    printf("\n=== PollDecoder (%u iterations) ===\n", (unsigned)o.iterations);
+    PollDecoder decoder;
+    for (const Shape& sh : shapes) {
+        std::string frame = MockGameServer::pollFrame(7, sh.p, sh.c, sh.b);
+        const uint8_t* data = (const uint8_t*)frame.data();
+        printf(" %s, %u bytes\n", sh.name, (unsigned)frame.size());
+
+        decoder.decode(data, frame.size());   // warm up
+        if (decoder.result() != PollDecoder::COMPLETE) {
+            printf("  frame rejected: %s\n", decoder.error());
+            continue;
+        }
+        volatile uint32_t sink = 0;
+        Sample whole = measure(o.iterations, [&](uint32_t) {
+            decoder.decode(data, frame.size());
+            sink = sink + decoder.production.size();
+        });
+        report("whole frame", o.iterations, whole, frame.size());
+
+        // As the worker sees it: the body arrives in socket-sized reads
+        const size_t chunk = 64;
+        Sample streamed = measure(o.iterations, [&](uint32_t) {
+            decoder.begin(200);
+            for (size_t at = 0; at < frame.size(); at += chunk) {
+                decoder.write(data + at, std::min(chunk, frame.size() - at));
+            }
+            decoder.end(true);
+            sink = sink + decoder.consumption.size();
+        });
+        report("64-byte chunks", o.iterations, streamed, frame.size());
+    }
+}
+
+// ───────────────────────────────────────────── boards
+struct BoardSim {
+    uint32_t index;
+    BoardType type;
+    std::vector<ConnectedPowerPlant> plants;
+    std::vector<ConnectedConsumer> consumers;
+
+    // Same shapes as the src/main.cpp simulator
+    float production() const {
+        bool day = (millis() / 10000) % 2 == 0;
+        switch (type) {
+            case BOARD_SOLAR:   return day ? 45.0f * (1.0f + random(-20, 21) / 100.0f) : 0.0f;
+            case BOARD_WIND:    return (day ? 25.0f : 30.0f) * (1.0f + random(-50, 51) / 100.0f);
+            case BOARD_BATTERY: return (day ? 20.0f : 5.0f) * (1.0f + random(-10, 11) / 100.0f);
+            default:            return 20.0f * (1.0f + random(-30, 31) / 100.0f);
+        }
+    }
+    float consumption() const {
+        bool day = (millis() / 10000) % 2 == 0;
+        return (day ? 25.0f : 15.0f) * (1.0f + random(-20, 21) / 100.0f);
+    }
+};
+
+static std::string serverUrl(const Options& o) { return o.url.empty() ? "http://mock" : o.url; }
+
+static void configureApi(ESPGameAPI& api, BoardSim& sim, const Options& o) {
+    api.setProductionCallback([&sim]() { return sim.production(); });
+    api.setConsumptionCallback([&sim]() { return sim.consumption(); });
+    api.setPowerPlantsCallback([&sim]() {
+        for (auto& p : sim.plants) p.set_power = random(500, 2000) / 1000.0f;
+        return sim.plants;
+    });
+    api.setConsumersCallback([&sim]() { return sim.consumers; });
+    api.setUpdateInterval(o.updateMs);
+    api.setPollInterval(o.pollMs);
+    api.setAdaptiveIntervals(o.adaptive);
+    api.setCompactProtocol(o.compact);
+    api.setPushMode(o.push);
+    api.setPipelining(o.pipeline);
+    api.setDeferredCallbacks(o.deferred);
+}
+
+static BoardSim makeSim(uint32_t index) {
+    BoardSim sim;
+    sim.index = index;
+    sim.type = static_cast<BoardType>(index % 4);
+    for (uint32_t i = 0; i < 2 + index % 2; i++) sim.plants.push_back({ 1000 * (index + 1) + i, 1.5f });
+    for (uint32_t i = 0; i < 3; i++) sim.consumers.push_back({ 2000 * (index + 1) + i });
+    return sim;
+}
+
+static String userName(const Options& o, uint32_t index) {
+    char name[64];
+    snprintf(name, sizeof(name), o.user.c_str(), (unsigned)(index + 1));
+    return String(name);
+}
+
+// update() until online or the deadline; returns the ms it took (0 = never)
+static uint32_t bringOnline(ESPGameAPI& api, uint32_t timeoutMs) {
+    uint32_t start = millis();
+    while (millis() - start < timeoutMs) {
+        api.update();
+        if (api.getConnectionState() == CONN_ONLINE) return millis() - start + 1;
+        delay(1);
+    }
+    return 0;
+}
+
+// ───────────────────────────────────────────── encode
+static void benchEncode(const Options& o) {
+    printf("\n=== Submit / report cost on the loop task (%u iterations) ===\n", (unsigned)o.iterations);
+    // Never destroyed: worker callbacks may still hold `this` when we return
+    BoardSim& sim = *new BoardSim(makeSim(0));
+    ESPGameAPI& api = *new ESPGameAPI(serverUrl(o).c_str(), "bench-encode", sim.type);
+    configureApi(api, sim, o);
+    api.setUpdateInterval(3600000);   // nothing but the calls below
+    api.setPollInterval(3600000);
+    api.connect(userName(o, 0), o.password.c_str());
+    if (!bringOnline(api, 10000)) {
+        printf("  board did not come online (server %s)\n", serverUrl(o).c_str());
+        return;
+    }
+
+    ConnectedBuilding buildings[4];
+    for (uint8_t i = 0; i < 4; i++) {
+        char uid[16];
+        snprintf(uid, sizeof(uid), "04a1b2c3d4e5%02x", i);
+        buildings[i].setUid(uid);
+        buildings[i].building_type = i;
+    }
+    const uint32_t n = o.iterations / 10 ? o.iterations / 10 : 1;   // each call also enqueues I/O
+    uint32_t poolMisses = AsyncRequest::poolMisses();
+
+    for (int pass = 0; pass < (o.compact ? 2 : 1); pass++) {
+        bool compact = pass == 1;
+        api.setCompactProtocol(compact);
+        printf(" %s frames\n", compact ? "compact" : "legacy");
+        report("submitPowerData", n, measure(n, [&](uint32_t i) {
+            api.submitPowerData(40.0f + (i % 7), 20.0f + (i % 5));
+        }));
+        report("submitPowerDataWithBuildings", n, measure(n, [&](uint32_t i) {
+            api.submitPowerDataWithBuildings(40.0f + (i % 7), 20.0f + (i % 5), ItemView<ConnectedBuilding>(buildings, 4));
+        }));
+        report("reportConnectedPowerPlants", n, measure(n, [&](uint32_t) {
+            api.reportConnectedPowerPlants(sim.plants);
+        }));
+    }
+    delay(200);   // let the workers drain the queue
+    printf("  pool misses during the run: %u\n", (unsigned)(AsyncRequest::poolMisses() - poolMisses));
+}
+
+// ───────────────────────────────────────────── load
+// What a board process sends back to the parent (plain data, piped as bytes)
+struct BoardReport {
+    AsyncRequest::Metrics metrics;
+    HostNet::Stats net;
+    uint32_t onlineAfterMs;     // 0 = never came online
+    uint8_t  finalState;
+    uint32_t linkDrops;         // --flap-ms
+    uint32_t offlineMs;         // not online after first coming online
+};
+
+// --flap-ms: takes the host link down on a schedule; WiFiLink brings it back
+struct LinkFlapper {
+    const Options& o;
+    WiFiLink& link;
+    uint32_t nextDrop, upAt = 0;
+    bool down = false;
+    explicit LinkFlapper(const Options& o)
+        : o(o), link(*new WiFiLink("host", "")), nextDrop(millis() + o.flapMs) {   // outlives the run
+        if (o.flapMs) link.begin();
+    }
+    void update() {
+        if (!o.flapMs) return;
+        uint32_t now = millis();
+        if (!down && (int32_t)(now - nextDrop) >= 0) {
+            WiFi.setLinkDown(true);
+            down = true;
+            upAt = now + o.outageMs;
+        } else if (down && (int32_t)(now - upAt) >= 0) {
+            WiFi.setLinkDown(false);   // the next reconnect attempt associates
+            down = false;
+            nextDrop = now + o.flapMs;
+        }
+        link.update();
+    }
+};
+
+static void runBoard(const Options& o, uint32_t index, BoardReport& out) {
+    BoardSim& sim = *new BoardSim(makeSim(index));   // outlive late callbacks, as above
+    char name[32];
+    snprintf(name, sizeof(name), "sim-%u", (unsigned)(index + 1));
+    ESPGameAPI& api = *new ESPGameAPI(serverUrl(o).c_str(), name, sim.type);
+    configureApi(api, sim, o);
+
+    // Boards don't boot in lockstep
+    delay(o.boards > 1 ? esp_random() % 500 : 0);
+    uint32_t start = millis(), end = start + o.seconds * 1000;
+    LinkFlapper flapper(o);
+    api.connect(userName(o, index), o.password.c_str());
+    out.onlineAfterMs = 0;
+    out.offlineMs = 0;
+    uint32_t last = start;
+    while ((int32_t)(millis() - end) < 0) {
+        flapper.update();
+        api.update();
+        uint32_t now = millis();
+        bool online = api.getConnectionState() == CONN_ONLINE;
+        if (!out.onlineAfterMs && online) out.onlineAfterMs = now - start + 1;
+        else if (out.onlineAfterMs && !online) out.offlineMs += now - last;
+        last = now;
+        delay(o.tickMs);
+    }
+    AsyncRequest::metrics(out.metrics);
+    out.net = HostNet::stats();
+    out.finalState = api.getConnectionState();
+    out.linkDrops = flapper.link.drops();
+}
+
+// Board 0 owns the connection, the rest are virtual boards on top of it,
+// as SIM_BOARDS does on a device. Metrics are process-wide, so one report.
+static void runFleet(const Options& o, BoardReport& out, std::vector<uint32_t>& onlineMs) {
+    std::vector<BoardSim*> sims;
+    std::vector<ESPGameAPI*> apis;
+    std::vector<uint32_t> connectAt, onlineAt;
+    for (uint32_t i = 0; i < o.boards; i++) {
+        BoardSim* sim = new BoardSim(makeSim(i));   // never destroyed, as above
+        char name[32];
+        snprintf(name, sizeof(name), "sim-%u", (unsigned)(i + 1));
+        ESPGameAPI* api = i == 0 ? new ESPGameAPI(serverUrl(o).c_str(), name, sim->type)
+                                 : new ESPGameAPI(*apis[0], name, sim->type);
+        configureApi(*api, *sim, o);
+        sims.push_back(sim);
+        apis.push_back(api);
+        connectAt.push_back(esp_random() % 500);
+        onlineAt.push_back(0);
+    }
+
+    uint32_t start = millis(), end = start + o.seconds * 1000;
+    std::vector<bool> connecting(o.boards, false);
+    LinkFlapper flapper(o);
+    out.offlineMs = 0;
+    uint32_t last = start;
+    while ((int32_t)(millis() - end) < 0) {
+        flapper.update();
+        uint32_t elapsed = millis() - start;
+        if (onlineAt[0] && apis[0]->getConnectionState() != CONN_ONLINE) out.offlineMs += millis() - last;
+        last = millis();
+        for (uint32_t i = 0; i < o.boards; i++) {
+            if (!connecting[i] && elapsed >= connectAt[i]) {
+                apis[i]->connect(userName(o, i), o.password.c_str());
+                connecting[i] = true;
+            }
+            apis[i]->update();
+            if (!onlineAt[i] && apis[i]->getConnectionState() == CONN_ONLINE) onlineAt[i] = elapsed + 1;
+        }
+        delay(o.tickMs);
+    }
+    AsyncRequest::metrics(out.metrics);
+    out.net = HostNet::stats();
+    out.onlineAfterMs = onlineAt[0];
+    out.finalState = apis[0]->getConnectionState();
+    out.linkDrops = flapper.link.drops();
+    for (uint32_t ms : onlineAt) if (ms) onlineMs.push_back(ms);
+}
+
+static void merge(AsyncRequest::Histogram& into, const AsyncRequest::Histogram& h) {
+    for (int b = 0; b < AsyncRequest::Histogram::BUCKETS; b++) into.bucket[b] += h.bucket[b];
+    into.count += h.count;
+    if (h.maxMs > into.maxMs) into.maxMs = h.maxMs;
+}
+
+static void merge(BoardReport& into, const BoardReport& r) {
+    AsyncRequest::Metrics& m = into.metrics;
+    const AsyncRequest::Metrics& s = r.metrics;
+    m.requests += s.requests; m.queueFull += s.queueFull; m.superseded += s.superseded; m.beginFail += s.beginFail;
+    m.newConnections += s.newConnections; m.reusedConnections += s.reusedConnections;
+    m.warmDispatches += s.warmDispatches; m.coldDispatches += s.coldDispatches;
+    m.pipelined += s.pipelined; m.pipelineFallbacks += s.pipelineFallbacks;
+    m.dnsHits += s.dnsHits; m.dnsLookups += s.dnsLookups; m.dnsStale += s.dnsStale;
+    m.deadlineMisses += s.deadlineMisses; m.cancelled += s.cancelled;
+    m.hedged += s.hedged; m.hedgeWins += s.hedgeWins;
+    m.bytesIn += s.bytesIn; m.bytesOut += s.bytesOut;
+    if (s.maxQueueDepth > m.maxQueueDepth) m.maxQueueDepth = s.maxQueueDepth;
+    merge(m.inQueue, s.inQueue);
+    merge(m.connect, s.connect);
+    merge(m.body, s.body);
+    for (int i = 0; i < ASYNCREQUEST_METRIC_SLOTS; i++) {
+        merge(m.slot[i].total, s.slot[i].total);
+        m.slot[i].errors += s.slot[i].errors;
+        m.slot[i].httpErrors += s.slot[i].httpErrors;
+        m.slot[i].bytesIn += s.slot[i].bytesIn;
+        m.slot[i].bytesOut += s.slot[i].bytesOut;
+    }
+    into.net.connects += r.net.connects; into.net.refused += r.net.refused; into.net.lost += r.net.lost;
+    into.net.lookups += r.net.lookups; into.net.stalled += r.net.stalled;
+    into.net.mockRequests += r.net.mockRequests;
+    into.net.bytesOut += r.net.bytesOut; into.net.bytesIn += r.net.bytesIn;
+    into.linkDrops += r.linkDrops; into.offlineMs += r.offlineMs;
+}
+
+static void printPercentiles(const char* what, const AsyncRequest::Histogram& h) {
+    printf("  %-10s p50 %5u  p95 %5u  p99 %5u  max %5u ms  (n=%u)\n", what,
+           (unsigned)h.percentile(50), (unsigned)h.percentile(95), (unsigned)h.percentile(99),
+           (unsigned)h.maxMs, (unsigned)h.count);
+}
+
+static void benchLoad(const Options& o) {
+    const HostNet::Faults& f = o.faults;
+    printf("\n=== Load: %u board(s), %u s, %s, latency %u-%u ms, loss %.1f%%, refuse %.1f%% ===\n",
+           (unsigned)o.boards, (unsigned)o.seconds, serverUrl(o).c_str(),
+           (unsigned)f.latencyMinMs, (unsigned)f.latencyMaxMs, f.lossPercent, f.refusePercent);
+    fflush(stdout);
+
+    static BoardReport total, one;   // ~8 KB each
+    std::vector<uint32_t> onlineMs;
+    uint32_t online = 0;
+
+    if (o.fleet) {
+        runFleet(o, total, onlineMs);
+        online = onlineMs.size();
+    } else if (o.boards == 1) {
+        runBoard(o, 0, total);
+        if (total.onlineAfterMs) { online = 1; onlineMs.push_back(total.onlineAfterMs); }
+    } else {
+        // One process per board: each has its own AsyncRequest queue and
+        // workers, exactly like separate devices
+        std::vector<std::pair<pid_t, int>> children;
+        for (uint32_t i = 0; i < o.boards; i++) {
+            int fds[2];
+            if (pipe(fds) != 0) { perror("pipe"); break; }
+            pid_t pid = fork();
+            if (pid < 0) { perror("fork"); close(fds[0]); close(fds[1]); break; }
+            if (pid == 0) {
+                close(fds[0]);
+                randomSeed(getpid());
+                BoardReport r;
+                runBoard(o, i, r);
+                const char* p = (const char*)&r;
+                for (size_t left = sizeof(r); left;) {
+                    ssize_t n = write(fds[1], p, left);
+                    if (n <= 0) break;
+                    p += n; left -= n;
+                }
+                _exit(0);
+            }
+            close(fds[1]);
+            children.push_back(std::make_pair(pid, fds[0]));
+        }
+        for (auto& c : children) {
+            char* p = (char*)&one;
+            size_t got = 0;
+            while (got < sizeof(one)) {
+                ssize_t n = read(c.second, p + got, sizeof(one) - got);
+                if (n <= 0) break;
+                got += n;
+            }
+            close(c.second);
+            waitpid(c.first, NULL, 0);
+            if (got != sizeof(one)) continue;
+            merge(total, one);
+            if (one.onlineAfterMs) { online++; onlineMs.push_back(one.onlineAfterMs); }
+        }
+    }
+
+    std::sort(onlineMs.begin(), onlineMs.end());
+    const AsyncRequest::Metrics& m = total.metrics;
+    printf("  online: %u/%u boards", (unsigned)online, (unsigned)o.boards);
+    if (!onlineMs.empty()) printf(", time to online p50 %u ms, max %u ms",
+                                  (unsigned)onlineMs[onlineMs.size() / 2], (unsigned)onlineMs.back());
+    printf("\n  requests %u (%.1f/s)  queue_full %u  superseded %u  beginFail %u  max depth %u\n",
+           (unsigned)m.requests, m.requests / (double)(o.seconds ? o.seconds : 1),
+           (unsigned)m.queueFull, (unsigned)m.superseded, (unsigned)m.beginFail, (unsigned)m.maxQueueDepth);
+    printf("  connections %u new / %u reused  dispatch %u warm / %u cold  pipelined %u (+%u re-sent)\n",
+           (unsigned)m.newConnections, (unsigned)m.reusedConnections,
+           (unsigned)m.warmDispatches, (unsigned)m.coldDispatches,
+           (unsigned)m.pipelined, (unsigned)m.pipelineFallbacks);
+    printf("  dns: %u cached, %u resolved, %u stale  %u lookups on the wire\n",
+           (unsigned)m.dnsHits, (unsigned)m.dnsLookups, (unsigned)m.dnsStale, (unsigned)total.net.lookups);
+    printf("  tail: %u stalled  %u deadline misses, %u cancelled  %u hedged, %u won\n",
+           (unsigned)total.net.stalled, (unsigned)m.deadlineMisses, (unsigned)m.cancelled,
+           (unsigned)m.hedged, (unsigned)m.hedgeWins);
+    printf("  transport: %u connects, %u refused, %u lost  %llu B out / %llu B in\n",
+           (unsigned)total.net.connects, (unsigned)total.net.refused, (unsigned)total.net.lost,
+           (unsigned long long)total.net.bytesOut, (unsigned long long)total.net.bytesIn);
+    if (o.flapMs) {
+        printf("  link: %u drops of %u ms, %u ms offline in total (%u ms per drop and board)\n",
+               (unsigned)total.linkDrops, (unsigned)o.outageMs, (unsigned)total.offlineMs,
+               (unsigned)(total.linkDrops ? total.offlineMs / total.linkDrops : 0));
+    }
+    printPercentiles("in queue", m.inQueue);
+    printPercentiles("connect", m.connect);
+    printPercentiles("body", m.body);
+    for (uint8_t i = 0; i < ASYNCREQUEST_METRIC_SLOTS; i++) {
+        const AsyncRequest::SlotMetrics& sm = m.slot[i];
+        if (!sm.total.count) continue;
+        printf("  %-30s n=%-6u err=%-4u http=%-4u p50=%u p95=%u p99=%u max=%u ms\n",
+               ESPGameAPI::metricsSlotName(i), (unsigned)sm.total.count, (unsigned)sm.errors,
+               (unsigned)sm.httpErrors, (unsigned)sm.total.percentile(50), (unsigned)sm.total.percentile(95),
+               (unsigned)sm.total.percentile(99), (unsigned)sm.total.maxMs);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parseArgs(argc, argv, o)) {
+        usage();
+        return 2;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    static MockGameServer server(o.mock);   // forked boards inherit it
+    if (o.url.empty()) server.install("mock");
+    // Virtual boards share one queue; give each about three slots
+    AsyncRequest::configure(o.workers, true, o.fleet ? (uint8_t)std::min<uint32_t>(o.boards * 3, 255) : 0);
+
+    if (o.mode == "decode" || o.mode == "all") benchDecode(o);
+    if (o.mode == "encode" || o.mode == "all") {
+        benchEncode(o);
+        ESPGameAPI::resetMetrics();
+        HostNet::resetStats();
+    }
+    // Faults only for the load run; the microbenchmarks measure CPU cost
+    HostNet::setFaults(o.faults);
+    if (o.mode == "load") benchLoad(o);
+    if (o.mode == "all") {
+        o.boards = 1;
+        o.seconds = o.seconds < 5 ? o.seconds : 5;
+        benchLoad(o);
+    }
+
+    // Worker threads are still running; skip static destructors
+    fflush(stdout);
+    _exit(0);
+}
@@ -10,6 +10,10 @@
 #define WIFI_SSID "PotkaniNora"
 #define WIFI_PASSWORD "PrimaryPapikTarget"
 #define WIFI_TIMEOUT_MS 30000
+// Optional static address (skips DHCP on every reconnect), e.g.
+// #define WIFI_STATIC_IP      192, 168, 2, 50
+// #define WIFI_STATIC_GATEWAY 192, 168, 2, 1
+// #define WIFI_STATIC_SUBNET  255, 255, 255, 0
 
 // Server Configuration  
 #define SERVER_URL "http://192.168.2.131"
@@ -20,10 +24,23 @@
 #define BOARD_NAME "ESP32-S3-DevKitC-1"
 #define BOARD_TYPE BOARD_SOLAR  // BOARD_SOLAR, BOARD_WIND, BOARD_BATTERY, BOARD_GENERIC
 
+// Multi-board simulation (load tests): SIM_BOARDS > 1 runs that many boards
+// on this device; board N logs in as SIM_USERNAME_FORMAT with N and the
+// password above. Logins are spread SIM_STAGGER_MS apart.
+#ifndef SIM_BOARDS
+#define SIM_BOARDS 1
+#endif
+#ifndef SIM_USERNAME_FORMAT
+#define SIM_USERNAME_FORMAT "board%u"
+#endif
+#ifndef SIM_STAGGER_MS
+#define SIM_STAGGER_MS 500
+#endif
+
 // Timing Configuration
 #define POLL_INTERVAL_MS 5000        // How often to poll server status (increased)
 #define DATA_SUBMIT_INTERVAL_MS 3000 // How often to submit data when expected
-#define RECONNECT_DELAY_MS 5000      // Delay before WiFi reconnection attempt
+#define RECONNECT_DELAY_MS 5000      // Between full WiFi reconnect attempts (WiFiLink)
 #define STATUS_PRINT_INTERVAL_MS 15000 // How often to print status updates
 
 // Power Generation Configuration
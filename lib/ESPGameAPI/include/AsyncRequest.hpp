@@ -5,21 +5,37 @@
 #include <HTTPClient.h>
 #include <WiFiClient.h>
 #include <WiFiClientSecure.h>
+#include <WiFi.h>
 #include <esp_err.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <vector>
 #include <string>
 #include <functional>
 #include <algorithm>
 #include <stdlib.h>
+#include <string.h>
+#include "debug_config.h"
 
 #ifndef ASYNCREQUEST_QUEUE_LEN
-#define ASYNCREQUEST_QUEUE_LEN 12
+#define ASYNCREQUEST_QUEUE_LEN 12   // default for configure(), which can size it per application
+#endif
+#ifndef ASYNCREQUEST_POOL_LEN
+#define ASYNCREQUEST_POOL_LEN (ASYNCREQUEST_QUEUE_LEN + 4) // queued + in flight
+#endif
+#ifndef ASYNCREQUEST_DONE_QUEUE_LEN
+#define ASYNCREQUEST_DONE_QUEUE_LEN ASYNCREQUEST_POOL_LEN // deferred completions
 #endif
 #ifndef ASYNCREQUEST_WORKER_STACK
-#define ASYNCREQUEST_WORKER_STACK 6144
+#define ASYNCREQUEST_WORKER_STACK 6144  // bytes; see workerStackFree()
+#endif
+#ifndef ASYNCREQUEST_WORKER_PRIORITY
+#define ASYNCREQUEST_WORKER_PRIORITY (tskIDLE_PRIORITY + 1)
+#endif
+#ifndef ASYNCREQUEST_WORKER_CORE
+#define ASYNCREQUEST_WORKER_CORE 0      // protocol core, next to the WiFi and lwIP tasks
 #endif
 #ifndef ASYNCREQUEST_IDLE_TIMEOUT_MS
 #define ASYNCREQUEST_IDLE_TIMEOUT_MS 15000   // increased from 1500ms -> ~10s
@@ -30,11 +46,41 @@
 #ifndef ASYNCREQUEST_CONNECT_TIMEOUT_MS
 #define ASYNCREQUEST_CONNECT_TIMEOUT_MS 15000 // increased from 1500ms -> ~10s
 #endif
+#ifndef ASYNCREQUEST_MAX_WORKERS
+#define ASYNCREQUEST_MAX_WORKERS 4   // upper bound for configure(maxWorkers)
+#endif
+#ifndef ASYNCREQUEST_ORIGIN_CACHE
+#define ASYNCREQUEST_ORIGIN_CACHE 2  // warm connections kept per worker (each TLS one holds mbedTLS buffers)
+#endif
+#ifndef ASYNCREQUEST_ORIGIN_IDLE_MS
+#define ASYNCREQUEST_ORIGIN_IDLE_MS 60000 // close connections unused this long
+#endif
+#ifndef ASYNCREQUEST_DNS_CACHE
+#define ASYNCREQUEST_DNS_CACHE 4     // hostnames whose address is kept (0 = HTTPClient resolves per connect)
+#endif
+#ifndef ASYNCREQUEST_DNS_TTL_MS
+#define ASYNCREQUEST_DNS_TTL_MS 300000 // re-resolve after this; a failed lookup keeps the old address
+#endif
+#ifndef ASYNCREQUEST_PIPELINE_MAX
+#define ASYNCREQUEST_PIPELINE_MAX 4  // requests written back-to-back per round trip
+#endif
+#ifndef ASYNCREQUEST_HEDGE_MIN_MS
+#define ASYNCREQUEST_HEDGE_MIN_MS 250       // HEDGE_P95 never sends the copy sooner
+#endif
+#ifndef ASYNCREQUEST_HEDGE_MIN_SAMPLES
+#define ASYNCREQUEST_HEDGE_MIN_SAMPLES 20   // slot latencies needed before HEDGE_P95 hedges
+#endif
 #ifndef ASYNCREQUEST_FORCE_CLOSE
 #define ASYNCREQUEST_FORCE_CLOSE 0   // 1 = disable keep-alive reuse
 #endif
 #ifndef ASYNCREQUEST_DEBUG
-#define ASYNCREQUEST_DEBUG 1         // set 0 to silence
+#define ASYNCREQUEST_DEBUG 0         // 1 = per-request [TIMING] lines (slow; see metrics())
+#endif
+#ifndef ASYNCREQUEST_METRICS
+#define ASYNCREQUEST_METRICS 1       // 0 = compile out histograms and counters
+#endif
+#ifndef ASYNCREQUEST_METRIC_SLOTS
+#define ASYNCREQUEST_METRIC_SLOTS 16 // per-endpoint slots, picked by Options::metricsSlot
 #endif
 
 #if ASYNCREQUEST_DEBUG
@@ -46,88 +92,942 @@
 class AsyncRequest {
 public:
   enum class Method { GET, POST };
+  // Scheduling lanes, served strictly in this order (FIFO within a lane)
+  enum class Priority : uint8_t { AUTH = 0, POLL = 1, TELEMETRY = 2, REPORT = 3 };
+  typedef std::vector<std::pair<std::string,std::string>> Headers;
   typedef std::function<void(esp_err_t,int,std::string)> DoneCB;
+  typedef std::function<void(esp_err_t,int,std::string,const Headers&)> DoneHdrCB;
+  // Zero-copy completion: the body stays in library-owned storage and is only
+  // valid during the call. DoneCB / DoneHdrCB get the buffer moved in instead.
+  typedef std::function<void(esp_err_t,int,const uint8_t*,size_t)> DoneViewCB;
+  // Returned by fetch() for cancel(); 0 when the request was dropped at once
+  typedef uint32_t Handle;
+  static const uint32_t HEDGE_P95 = 0xFFFFFFFFu;   // Options::hedgeAfterMs: the slot's p95
+
+  // Streaming consumer for a response body. When set, 2xx bodies are fed to
+  // the sink as they arrive (on the worker task) instead of being collected,
+  // and the completion callback receives an empty body.
+  struct BodySink {
+    virtual ~BodySink() {}
+    virtual void begin(int status) = 0;
+    virtual bool write(const uint8_t *data, size_t len) = 0;  // false = stop reading
+    virtual void end(bool complete) = 0;
+  };
+
+  // Per-request options for the extended fetch() overload
+  struct Options {
+    const char **collectHeaders;  // response header names to hand back (static storage)
+    size_t collectCount;
+    uint32_t timeoutMs;           // response/idle timeout, 0 = ASYNCREQUEST_IDLE_TIMEOUT_MS
+    Priority priority;
+    uint32_t coalesceKey;         // !=0: replaces a still-queued request with the same key
+    BodySink *sink;               // optional, must outlive the request
+    uint8_t metricsSlot;          // latency histogram to record into (0 = other)
+    bool pipeline;                // may share a round trip with other queued pipeline requests
+                                  // to the same origin (small, no sink/headers); a POST
+                                  // written but left unanswered fails, it is not re-sent
+    bool connectOnly;             // prewarm(): open the connection, send nothing
+    uint32_t originHash;          // originHash(url) computed once by the caller, 0 = per request
+    uint32_t deadlineMs;          // fails with ESP_ERR_TIMEOUT this long after fetch(), queued or
+                                  // running; also caps the connect/idle timeouts (0 = none)
+    uint32_t hedgeAfterMs;        // idempotent GETs: no response this long after it started sends
+                                  // a copy on another worker, the first response wins (0 = off)
+    Options(): collectHeaders(NULL), collectCount(0), timeoutMs(0),
+               priority(Priority::TELEMETRY), coalesceKey(0), sink(NULL), metricsSlot(0), pipeline(false),
+               connectOnly(false), originHash(0), deadlineMs(0), hedgeAfterMs(0) {}
+  };
 
-  static void configure(uint8_t maxWorkers = 1, bool allowInsecureTLS = true) {
+  // Fixed-size latency histogram in milliseconds: exact below 4 ms, then four
+  // buckets per power of two (<= 19% error), saturating at ~65 s.
+  struct Histogram {
+    enum { BUCKETS = 60 };
+    uint32_t bucket[BUCKETS];
+    uint32_t count;
+    uint32_t maxMs;
+    Histogram() { clear(); }
+    void clear() { memset(bucket, 0, sizeof(bucket)); count = 0; maxMs = 0; }
+    static uint8_t index(uint32_t ms) {
+      if (ms < 4) return (uint8_t)ms;
+      uint8_t octave = 31 - __builtin_clz(ms);
+      if (octave > 15) return BUCKETS - 1;
+      return (uint8_t)(4 + (octave - 2) * 4 + ((ms >> (octave - 2)) & 3));
+    }
+    static uint32_t upperBound(uint8_t b) {
+      if (b < 4) return b;
+      uint8_t octave = (b - 4) / 4 + 2, sub = (b - 4) % 4;
+      return ((4u + sub) << (octave - 2)) + (1u << (octave - 2)) - 1;
+    }
+    void add(uint32_t ms) { bucket[index(ms)]++; count++; if (ms > maxMs) maxMs = ms; }
+    // Upper bound of the bucket holding the p-th percentile (0 < p <= 100)
+    uint32_t percentile(float p) const {
+      if (!count) return 0;
+      uint32_t rank = (uint32_t)(count * p / 100.0f + 0.5f); if (!rank) rank = 1;
+      uint32_t seen = 0;
+      for (uint8_t b = 0; b < BUCKETS; ++b) {
+        seen += bucket[b];
+        if (seen >= rank) { uint32_t ub = upperBound(b); return ub < maxMs ? ub : maxMs; }
+      }
+      return maxMs;
+    }
+  };
+
+  struct SlotMetrics {
+    Histogram total;      // dequeue -> callback
+    uint32_t errors;      // transport failures (no HTTP status)
+    uint32_t httpErrors;  // status >= 400
+    uint32_t bytesIn, bytesOut;
+    SlotMetrics(): errors(0), httpErrors(0), bytesIn(0), bytesOut(0) {}
+  };
+
+  struct Metrics {
+    uint32_t requests;
+    uint32_t queueFull, superseded, beginFail;
+    uint32_t newConnections, reusedConnections;
+    uint32_t warmDispatches, coldDispatches;   // idle worker woken with / without a socket to the origin
+    uint32_t pipelined, pipelineFallbacks;     // answered in a pipeline / re-sent one by one (unsent or GET)
+    uint32_t dnsHits, dnsLookups, dnsStale;    // new connections: cached address / resolved / lookup failed, old one used
+    uint32_t deadlineMisses, cancelled;        // completed with "deadline" / "cancelled"
+    uint32_t hedged, hedgeWins;                // copies sent / copies that answered first
+    uint32_t bytesIn, bytesOut;
+    uint8_t  maxQueueDepth;
+    Histogram inQueue, connect, body;   // phases, all endpoints
+    SlotMetrics slot[ASYNCREQUEST_METRIC_SLOTS];
+    Metrics(): requests(0), queueFull(0), superseded(0), beginFail(0),
+               newConnections(0), reusedConnections(0), warmDispatches(0), coldDispatches(0),
+               pipelined(0), pipelineFallbacks(0), dnsHits(0), dnsLookups(0), dnsStale(0),
+               deadlineMisses(0), cancelled(0), hedged(0), hedgeWins(0),
+               bytesIn(0), bytesOut(0), maxQueueDepth(0) {}
+  };
+
+  // queueLen = 0 keeps ASYNCREQUEST_QUEUE_LEN. The request pool and the
+  // completion queue grow with it (many API instances in one process need
+  // more than one board's worth of slots). Only before the first request.
+  static void configure(uint8_t maxWorkers = 1, bool allowInsecureTLS = true, uint8_t queueLen = 0) {
     if (started_) return;
     if (maxWorkers == 0) maxWorkers = 1;
+    if (maxWorkers > ASYNCREQUEST_MAX_WORKERS) maxWorkers = ASYNCREQUEST_MAX_WORKERS;
     maxWorkers_ = maxWorkers;
     insecureTLS_ = allowInsecureTLS;
+    queueLen_ = queueLen ? queueLen : ASYNCREQUEST_QUEUE_LEN;
   }
+  static uint8_t queueLength() { return queueLen_; }
 
-  // Backwards compatibility wrapper (legacy signature). Ignores most params now.
-  static bool begin(uint8_t maxWorkers, uint8_t /*queueLenIgnored*/, uint32_t /*stackIgnored*/, UBaseType_t /*prioIgnored*/, BaseType_t /*coreIgnored*/) {
-    configure(maxWorkers, true);
-    return true; // always succeeds with current lightweight implementation
+  // Worker tasks: stack in bytes (0 = ASYNCREQUEST_WORKER_STACK), priority and
+  // core (tskNO_AFFINITY = either). The default keeps socket reads and TLS on
+  // core 0 with the WiFi stack, away from loop() on core 1. Only before the
+  // first request.
+  static void configureTasks(uint32_t stackBytes = ASYNCREQUEST_WORKER_STACK,
+                             UBaseType_t priority = ASYNCREQUEST_WORKER_PRIORITY,
+                             BaseType_t core = ASYNCREQUEST_WORKER_CORE) {
+    if (started_) return;
+    workerStack_ = stackBytes ? stackBytes : ASYNCREQUEST_WORKER_STACK;
+    workerPriority_ = priority;
+    workerCore_ = core;
   }
 
-  static void fetch(Method method,
+  // Legacy signature: configure() plus configureTasks(); queueLen and stack
+  // 0 keep the defaults
+  static bool begin(uint8_t maxWorkers, uint8_t queueLen, uint32_t stack, UBaseType_t prio, BaseType_t core) {
+    configure(maxWorkers, true, queueLen);
+    configureTasks(stack, prio, core);
+    return true; // workers start with the first request
+  }
+
+  // Smallest free stack (bytes) worker i has had so far, to size
+  // ASYNCREQUEST_WORKER_STACK; 0 when it isn't running
+  static uint32_t workerStackFree(uint8_t i) {
+    return i < workerCount_ ? (uint32_t)uxTaskGetStackHighWaterMark(workers_[i].task) : 0;
+  }
+  static uint8_t     workerCount()    { return workerCount_; }
+  static uint32_t    workerStack()    { return workerStack_; }
+  static UBaseType_t workerPriority() { return workerPriority_; }
+  static BaseType_t  workerCore()     { return workerCore_; }
+
+  static Handle fetch(Method method,
                     const std::string &url,
                     std::string payload,
-                    const std::vector<std::pair<std::string,std::string>> &headers,
+                    const Headers &headers,
                     DoneCB cb) {
-    init_();
-    if (!queue_) {
-      if (cb) cb(ESP_FAIL,-1,"no_queue");
-      return;
+    return fetch(method, url, (const uint8_t*)payload.data(), payload.size(), headers, Options(), std::move(cb));
+  }
+
+  // Same as above, but collects the response headers listed in opts and hands
+  // them to the callback (e.g. ETag, Retry-After).
+  static Handle fetch(Method method,
+                    const std::string &url,
+                    std::string payload,
+                    const Headers &headers,
+                    const Options &opts,
+                    DoneHdrCB cb) {
+    Request *r = acquire_();
+    prepare_(r, method, url, (const uint8_t*)payload.data(), payload.size(), headers.data(), headers.size(), opts);
+    r->hcb = std::move(cb);
+    return enqueue_(r);
+  }
+
+  // Options (priority, coalescing, ...) with the plain callback
+  static Handle fetch(Method method,
+                    const std::string &url,
+                    std::string payload,
+                    const Headers &headers,
+                    const Options &opts,
+                    DoneCB cb) {
+    return fetch(method, url, (const uint8_t*)payload.data(), payload.size(), headers, opts, std::move(cb));
+  }
+
+  // Allocation-free variant: the payload is copied into a pooled request whose
+  // buffers keep their capacity between uses. Pass long-lived url/headers and a
+  // callback small enough for std::function's inline storage (e.g. [this]).
+  static Handle fetch(Method method,
+                    const std::string &url,
+                    const uint8_t *payload, size_t len,
+                    const Headers &headers,
+                    const Options &opts,
+                    DoneCB cb) {
+    Request *r = acquire_();
+    prepare_(r, method, url, payload, len, headers.data(), headers.size(), opts);
+    r->cb = std::move(cb);
+    return enqueue_(r);
+  }
+
+  // Same, with the response headers listed in opts
+  static Handle fetch(Method method,
+                    const std::string &url,
+                    const uint8_t *payload, size_t len,
+                    const Headers &headers,
+                    const Options &opts,
+                    DoneHdrCB cb) {
+    Request *r = acquire_();
+    prepare_(r, method, url, payload, len, headers.data(), headers.size(), opts);
+    r->hcb = std::move(cb);
+    return enqueue_(r);
+  }
+
+  // Same, with a DoneViewCB: no body copy and no body ownership transfer
+  static Handle fetch(Method method,
+                    const std::string &url,
+                    const uint8_t *payload, size_t len,
+                    const Headers &headers,
+                    const Options &opts,
+                    DoneViewCB cb) {
+    Request *r = acquire_();
+    prepare_(r, method, url, payload, len, headers.data(), headers.size(), opts);
+    r->vcb = std::move(cb);
+    return enqueue_(r);
+  }
+
+  // Cancels a request from fetch(). A queued one completes at once, a running
+  // one at its next check: before it starts, once its response headers are
+  // in, between body chunks. Completes with ESP_FAIL and body "cancelled";
+  // false when the request has already finished.
+  static bool cancel(Handle h) {
+    if (!h || !started_) return false;
+    Request *removed[2]; uint8_t nRemoved = 0;   // the request and its hedge copy
+    bool found = false;
+    portENTER_CRITICAL(&lock_);
+    for (int i=0;i<queueLen_ && nRemoved < 2;++i) {
+      Request *q = slots_[i];
+      if (!q || q->id != h) continue;
+      slots_[i] = NULL; queued_--;
+      unpair_(q);
+      removed[nRemoved++] = q;
     }
-    Request *r = new Request{method,url,std::move(payload),headers,cb, millis()};
-    if (ASYNCREQUEST_DEBUG) {
-      UBaseType_t used = uxQueueMessagesWaiting(queue_);
-      UBaseType_t avail = uxQueueSpacesAvailable(queue_);
-      AR_LOGf("[AsyncRequest] -> enqueue %s %s q=%u/%u\n",
-              method==Method::GET?"GET":"POST", url.c_str(), used, used+avail);
+    for (uint8_t w=0;w<workerCount_;++w) {
+      for (uint8_t k=0;k<ASYNCREQUEST_PIPELINE_MAX;++k) {
+        Request *r = workers_[w].running[k];
+        if (r && r->id == h) { r->abort = ABORT_CANCEL; found = true; }
+      }
     }
-    if (xQueueSend(queue_, &r, 0) != pdTRUE) {
-      AR_LOGf("[AsyncRequest] DROP queue_full %s %s\n", method==Method::GET?"GET":"POST", url.c_str());
-      if (cb) cb(ESP_FAIL,-1,"queue_full");
-      delete r;
+    portEXIT_CRITICAL(&lock_);
+    for (uint8_t i=0;i<nRemoved;++i) { removed[i]->abort = ABORT_CANCEL; abort_(removed[i]); }
+    return found || nRemoved;
+  }
+
+  // Opens the keep-alive connection (DNS, TCP, TLS) to url's origin on an
+  // idle worker without sending anything, so the next request to it finds a
+  // warm socket. A no-op when that worker is still connected. Completes with
+  // status 200 (or ESP_FAIL) on cb, which may be null.
+  static Handle prewarm(const std::string &url, uint8_t metricsSlot = 0, DoneCB cb = nullptr) {
+    Options opts;
+    opts.priority = Priority::AUTH;
+    opts.originHash = hashOrigin_(url);
+    opts.coalesceKey = opts.originHash | 1;   // repeated prewarms replace each other
+    opts.metricsSlot = metricsSlot;
+    opts.connectOnly = true;
+    return fetch(Method::GET, url, NULL, 0, Headers(), opts, std::move(cb));
+  }
+
+  // Key the workers use to find a warm connection for url (Options::originHash)
+  static uint32_t originHash(const std::string &url) { return hashOrigin_(url); }
+
+  // Closes every worker's cached sockets, e.g. when the WiFi link drops and
+  // they would only fail on their next request. Idle workers close at once,
+  // busy ones before their next request. Safe from any task.
+  static void dropConnections() {
+    __atomic_add_fetch(&linkEpoch_, 1, __ATOMIC_SEQ_CST);
+    for (uint8_t i=0;i<workerCount_;++i) xTaskNotifyGive(workers_[i].task);
+  }
+
+  // Deferred completion: when on, workers only do I/O and park finished
+  // requests in a completion queue; callbacks run inside poll() on whichever
+  // task calls it (typically loop()). Body sinks still run on the worker.
+  static void setDeferredCallbacks(bool on) { deferCallbacks_ = on; }
+  static bool deferredCallbacks() { return deferCallbacks_; }
+
+  // Runs queued completion callbacks on the calling task. maxCallbacks = 0
+  // drains what is queued at entry (callbacks queued meanwhile wait for the
+  // next call). Returns the number of callbacks run.
+  static size_t poll(size_t maxCallbacks = 0) {
+    reap_(millis());
+    if (!done_) return 0;
+    size_t limit = uxQueueMessagesWaiting(done_);
+    if (maxCallbacks && maxCallbacks < limit) limit = maxCallbacks;
+    size_t n = 0;
+    Request *r;
+    while (n < limit && xQueueReceive(done_, &r, 0) == pdTRUE) {
+      finish_(r, r->err, r->status, r->respBody);
+      release_(r);
+      ++n;
     }
+    return n;
   }
 
+  // Holds worker wake-ups while several requests are queued, so requests
+  // marked Options::pipeline can be picked up together (RAII, nestable).
+  struct Batch {
+    Batch()  { __atomic_add_fetch(&batchDepth_, 1, __ATOMIC_SEQ_CST); }
+    ~Batch() {
+      if (__atomic_sub_fetch(&batchDepth_, 1, __ATOMIC_SEQ_CST)) return;
+      uint32_t held = __atomic_exchange_n(&heldWakeups_, 0, __ATOMIC_SEQ_CST);
+      while (held--) dispatch_(heldOrigin_);
+    }
+  };
+
+  // Consistent copy of the counters and histograms (cheap; safe from any task)
+  static void metrics(Metrics &out) {
+  #if ASYNCREQUEST_METRICS
+    portENTER_CRITICAL(&metricsLock_);
+    out = metrics_;
+    portEXIT_CRITICAL(&metricsLock_);
+  #else
+    out = Metrics();
+  #endif
+  }
+  static void resetMetrics() {
+  #if ASYNCREQUEST_METRICS
+    portENTER_CRITICAL(&metricsLock_);
+    metrics_ = Metrics();
+    portEXIT_CRITICAL(&metricsLock_);
+  #endif
+  }
+
+  // Heap allocations made while enqueueing (pool misses + buffer growth).
+  // Stays flat once the pool has warmed up on a steady request mix.
+  static uint32_t allocations() { return allocs_; }
+  static uint32_t poolMisses()  { return poolMisses_; }
+
 private:
   struct Request {
     Method method;
     std::string url;
     std::string payload;
-    std::vector<std::pair<std::string,std::string>> headers;
+    Headers headers;          // only the first nHeaders entries are live
+    uint8_t nHeaders;
+    Options opts;
     DoneCB cb;
+    DoneHdrCB hcb;
+    DoneViewCB vcb;
+    Headers respHeaders;      // filled by the worker when opts.collectCount > 0
+    std::string respBody;     // deferred completions only (swapped in, not copied)
+    esp_err_t err;
+    int status;
     uint32_t t_enq;
+    uint32_t seq;             // arrival order, keeps lanes FIFO
+    uint32_t originHash;      // scheme://host[:port], for worker affinity
+    uint32_t id;              // Handle; a hedge copy shares its original's
+    uint32_t notBefore;       // hedge copy: not dequeued before this (0 = now)
+    Request *twin;            // hedged pair, both ways (guarded by lock_)
+    volatile uint8_t abort;   // ABORT_*, set under lock_
+    bool hedgeCopy;
+    bool pooled;
+    Request *nextFree;
+    Request(): method(Method::GET), nHeaders(0), err(ESP_OK), status(-1), t_enq(0), seq(0), originHash(0),
+               id(0), notBefore(0), twin(NULL), abort(0), hedgeCopy(false), pooled(false), nextFree(NULL) {}
+  };
+  enum { ABORT_NONE = 0, ABORT_CANCEL, ABORT_DEADLINE, ABORT_LOST };   // LOST: the twin answered first
+
+  // Request pool: objects (and their string capacity) are recycled instead of
+  // new/delete per fetch. Falls back to the heap when exhausted. Allocated
+  // once by init_(), sized from the configured queue length.
+  static Request *pool_;
+  static uint16_t poolLen_;
+  static Request *freeList_;
+  static uint32_t allocs_;
+  static uint32_t poolMisses_;
+
+  static void countAlloc_() { __atomic_add_fetch(&allocs_, 1, __ATOMIC_RELAXED); }
+
+  static Request *acquire_() {
+    init_();
+    Request *r = NULL;
+    portENTER_CRITICAL(&lock_);
+    if (freeList_) { r = freeList_; freeList_ = r->nextFree; r->nextFree = NULL; }
+    portEXIT_CRITICAL(&lock_);
+    if (!r) {
+      r = new Request();
+      countAlloc_();
+      __atomic_add_fetch(&poolMisses_, 1, __ATOMIC_RELAXED);
+    }
+    return r;
+  }
+
+  static void release_(Request *r) {
+    r->cb = nullptr; r->hcb = nullptr; r->vcb = nullptr;   // drop captures now, not on reuse
+    r->respHeaders.clear();
+    r->respBody.clear();
+    portENTER_CRITICAL(&lock_);
+    for (uint8_t w=0;w<workerCount_;++w)   // out of cancel()'s reach
+      for (uint8_t k=0;k<ASYNCREQUEST_PIPELINE_MAX;++k) if (workers_[w].running[k] == r) workers_[w].running[k] = NULL;
+    r->id = 0;
+    if (r->pooled) { r->nextFree = freeList_; freeList_ = r; }
+    portEXIT_CRITICAL(&lock_);
+    if (!r->pooled) delete r;
+  }
+
+  static void assign_(std::string &dst, const char *p, size_t n) {
+    if (n > dst.capacity()) countAlloc_();
+    dst.assign(p, n);
+  }
+
+  static void prepare_(Request *r, Method method, const std::string &url,
+                       const uint8_t *payload, size_t len,
+                       const std::pair<std::string,std::string> *headers, size_t nHeaders,
+                       const Options &opts) {
+    r->method = method;
+    assign_(r->url, url.data(), url.size());
+    assign_(r->payload, (const char*)payload, len);
+    // header slots are never shrunk so their strings keep capacity
+    if (nHeaders > r->headers.size()) {
+      if (nHeaders > r->headers.capacity()) countAlloc_();
+      r->headers.resize(nHeaders);
+    }
+    for (size_t i=0;i<nHeaders;++i) {
+      assign_(r->headers[i].first,  headers[i].first.data(),  headers[i].first.size());
+      assign_(r->headers[i].second, headers[i].second.data(), headers[i].second.size());
+    }
+    r->nHeaders = (uint8_t)nHeaders;
+    r->opts = opts;
+    r->originHash = opts.originHash ? opts.originHash : hashOrigin_(r->url);
+    r->t_enq = millis();
+    r->notBefore = 0; r->twin = NULL; r->abort = ABORT_NONE; r->hedgeCopy = false;
+  }
+
+  // FNV-1a over the URL up to the path; never 0 (0 marks "no origin")
+  static uint32_t hashOrigin_(const std::string &url) {
+    size_t start = url.find("://");
+    start = start == std::string::npos ? 0 : start + 3;
+    size_t end = url.find('/', start);
+    if (end == std::string::npos) end = url.size();
+    uint32_t h = 2166136261u;
+    for (size_t i=0;i<end;++i) { h ^= (uint8_t)url[i]; h *= 16777619u; }
+    return h ? h : 1;
+  }
+
+  // Queue: slot array of queueLen_ entries (allocated once) guarded by a
+  // spinlock. Idle workers park on a task notification and are woken one at
+  // a time by dispatch_().
+  static Request **slots_;
+  static uint8_t queueLen_;
+  static uint8_t queued_;
+  static uint32_t seq_;
+  static uint32_t nextId_;
+  static portMUX_TYPE lock_;
+
+  // Worker registry for origin-affinity dispatch (guarded by lock_)
+  struct WorkerSlot {
+    TaskHandle_t task;
+    bool idle;                                  // parked, waiting for a kick
+    uint32_t warm[ASYNCREQUEST_ORIGIN_CACHE];   // origins with an open socket
+    Request *running[ASYNCREQUEST_PIPELINE_MAX]; // for cancel(); cleared by release_()
+  };
+  static WorkerSlot workers_[ASYNCREQUEST_MAX_WORKERS];
+  static uint8_t workerCount_;
+  static uint32_t batchDepth_;     // open Batch scopes
+  static uint32_t heldWakeups_;    // dispatches deferred by a Batch
+  static uint32_t heldOrigin_;
+
+  static Handle enqueue_(Request *r) {
+    init_();
+    if (!workerCount_) {
+      complete_(r, ESP_FAIL, -1, "no_queue");
+      return 0;
+    }
+    Request *evicted = NULL;   // finished outside the lock
+    const char *why = NULL;
+    bool added = false;
+
+    portENTER_CRITICAL(&lock_);
+    r->seq = seq_++;
+    if (!++nextId_) ++nextId_;
+    Handle id = r->id = nextId_;
+    int empty = -1, same = -1, victim = -1;
+    for (int i=0;i<queueLen_;++i) {
+      Request *q = slots_[i];
+      if (!q) { if (empty < 0) empty = i; continue; }
+      if (r->opts.coalesceKey && q->opts.coalesceKey == r->opts.coalesceKey) same = i;
+      // lowest lane first, oldest within it
+      if (q->opts.priority > r->opts.priority &&
+          (victim < 0 || q->opts.priority > slots_[victim]->opts.priority ||
+           (q->opts.priority == slots_[victim]->opts.priority && q->seq < slots_[victim]->seq))) victim = i;
+    }
+    if (same >= 0) {
+      // newer data takes the older request's place in line
+      evicted = slots_[same]; why = "superseded";
+      r->seq = evicted->seq;
+      slots_[same] = r;
+    } else if (empty >= 0) {
+      slots_[empty] = r; queued_++; added = true;
+    } else if (victim >= 0) {
+      evicted = slots_[victim]; why = "queue_full";
+      slots_[victim] = r;
+    } else {
+      evicted = r; why = "queue_full";
+    }
+    if (evicted) unpair_(evicted);   // an evicted hedge copy leaves its original alone
+    uint8_t depth = queued_;
+    portEXIT_CRITICAL(&lock_);
+    countEnqueue_(depth, evicted ? why : NULL);
+
+    if (added) {
+      if (__atomic_load_n(&batchDepth_, __ATOMIC_SEQ_CST)) {
+        heldOrigin_ = r->originHash;
+        __atomic_add_fetch(&heldWakeups_, 1, __ATOMIC_SEQ_CST);
+      } else {
+        dispatch_(r->originHash);
+      }
+    }
+    if (evicted != r) GAME_TRACE(TR_ENQUEUE, r->opts.metricsSlot, depth);
+    if (evicted) GAME_TRACE(TR_DROP, evicted->opts.metricsSlot, evicted != r && same >= 0);
+    if (evicted != r) {
+      AR_LOGf("[AsyncRequest] -> enqueue %s %s prio=%u q=%u/%u\n",
+              r->method==Method::GET?"GET":"POST", r->url.c_str(), (unsigned)r->opts.priority,
+              (unsigned)depth, (unsigned)queueLen_);
+    }
+    (void)depth;
+    if (evicted) {
+      AR_LOGf("[AsyncRequest] DROP %s %s %s\n", why, evicted->method==Method::GET?"GET":"POST", evicted->url.c_str());
+      complete_(evicted, ESP_FAIL, -1, why);
+    }
+    return evicted == r ? 0 : id;
+  }
+
+  // Wakes one idle worker for a new request: one already connected to the
+  // origin if possible, else the lowest-numbered one, so extra workers (and
+  // their sockets) only come into play under real concurrency. With no idle
+  // worker the request waits for the next busy worker to finish.
+  static void dispatch_(uint32_t originHash) {
+    int pick = -1; bool warm = false;
+    portENTER_CRITICAL(&lock_);
+    for (uint8_t i=0;i<workerCount_ && !warm;++i) {
+      WorkerSlot &w = workers_[i];
+      if (!w.idle) continue;
+      for (uint8_t k=0;k<ASYNCREQUEST_ORIGIN_CACHE;++k) if (w.warm[k] == originHash) warm = true;
+      if (warm || pick < 0) pick = i;
+    }
+    if (pick >= 0) workers_[pick].idle = false;
+    portEXIT_CRITICAL(&lock_);
+    if (pick < 0) return;
+    xTaskNotifyGive(workers_[pick].task);
+    countDispatch_(warm);
+  }
+
+  // Takes the most urgent queued request for worker `self`, or marks it idle.
+  // `warm` is the worker's current set of connected origins. Hedge copies
+  // that are not due yet are skipped; `wait` is lowered to the next one.
+  static Request *dequeue_(uint8_t self, const uint32_t *warm, uint32_t now, uint32_t &wait) {
+    Request *r = NULL;
+    portENTER_CRITICAL(&lock_);
+    WorkerSlot &w = workers_[self];
+    memcpy(w.warm, warm, sizeof(w.warm));
+    int best = -1;
+    for (int i=0;i<queueLen_;++i) {
+      Request *q = slots_[i];
+      if (!q) continue;
+      if (q->notBefore) {
+        int32_t due = (int32_t)(q->notBefore - now);
+        if (due > 0) { if ((uint32_t)due < wait) wait = (uint32_t)due; continue; }
+      }
+      if (best < 0 || q->opts.priority < slots_[best]->opts.priority ||
+          (q->opts.priority == slots_[best]->opts.priority && q->seq < slots_[best]->seq)) best = i;
+    }
+    if (best >= 0) { r = slots_[best]; slots_[best] = NULL; queued_--; }
+    memset(w.running, 0, sizeof(w.running));
+    w.running[0] = r;
+    w.idle = (r == NULL);
+    portEXIT_CRITICAL(&lock_);
+    return r;
+  }
+
+  static bool pipelinable_(const Request *r) {
+    return r->opts.pipeline && !r->opts.sink && !r->opts.collectCount;
+  }
+
+  // Takes up to `max` more queued pipeline requests for first's origin,
+  // most urgent first
+  static size_t gather_(uint8_t self, const Request *first, Request **out, size_t max) {
+    size_t n = 0;
+    portENTER_CRITICAL(&lock_);
+    while (n < max) {
+      int best = -1;
+      for (int i=0;i<queueLen_;++i) {
+        Request *q = slots_[i];
+        if (!q || q->originHash != first->originHash || !pipelinable_(q) || q->notBefore) continue;
+        if (best < 0 || q->opts.priority < slots_[best]->opts.priority ||
+            (q->opts.priority == slots_[best]->opts.priority && q->seq < slots_[best]->seq)) best = i;
+      }
+      if (best < 0) break;
+      out[n++] = slots_[best]; slots_[best] = NULL; queued_--;
+      workers_[self].running[n] = out[n-1];
+    }
+    portEXIT_CRITICAL(&lock_);
+    return n;
+  }
+
+  // ───── deadlines, cancel() and hedging
+
+  static bool expired_(const Request *r, uint32_t now) {
+    return r->opts.deadlineMs && now - r->t_enq >= r->opts.deadlineMs;
+  }
+  // ms until the deadline, 0xFFFFFFFF without one
+  static uint32_t timeLeft_(const Request *r, uint32_t now) {
+    if (!r->opts.deadlineMs) return 0xFFFFFFFFu;
+    uint32_t used = now - r->t_enq;
+    return used < r->opts.deadlineMs ? r->opts.deadlineMs - used : 0;
+  }
+  static bool stopped_(const Request *r, uint32_t now) { return r->abort || expired_(r, now); }
+  static bool hasCallback_(const Request *r) { return r->cb || r->hcb || r->vcb; }
+
+  // Under lock_: splits a hedged pair (one side left the queue)
+  static void unpair_(Request *r) {
+    if (r->twin) { r->twin->twin = NULL; r->twin = NULL; }
+  }
+
+  // Called by an attempt when its outcome is known. In a hedged pair the
+  // first final outcome (a response, cancel, deadline) wins and its twin is
+  // dropped; after a plain failure the twin carries on instead, at once if
+  // it was still waiting. The callbacks move to whichever side delivers.
+  // False: this attempt must not deliver (release it).
+  static bool settle_(Request *r, bool final) {
+    Request *drop = NULL, *retry = NULL;
+    bool keep, win = false;
+    portENTER_CRITICAL(&lock_);
+    keep = r->abort != ABORT_LOST;
+    Request *t = r->twin;
+    if (keep && t) {
+      Request *winner = final ? r : t, *loser = final ? t : r;
+      if (!hasCallback_(winner)) { winner->cb.swap(loser->cb); winner->hcb.swap(loser->hcb); winner->vcb.swap(loser->vcb); }
+      loser->abort = ABORT_LOST;
+      for (int i=0;i<queueLen_;++i) {
+        if (slots_[i] != t) continue;
+        if (final) { slots_[i] = NULL; queued_--; drop = t; }   // never started
+        else { t->notBefore = 0; retry = t; }
+      }
+      unpair_(r);
+      win = final && r->hedgeCopy;
+      keep = final;
+    }
+    portEXIT_CRITICAL(&lock_);
+    if (drop) release_(drop);
+    if (retry) dispatch_(retry->originHash);
+    if (win) countHedge_(true);
+    return keep;
+  }
+
+  // Ends a request that was cancelled, ran past its deadline or lost its
+  // hedge race
+  static void abort_(Request *r) {
+    uint8_t why = r->abort ? r->abort : (uint8_t)ABORT_DEADLINE;
+    if (!settle_(r, why != ABORT_LOST)) { release_(r); return; }
+    if (!r->hedgeCopy || hasCallback_(r)) countAbort_(why);
+    if (why == ABORT_CANCEL) complete_(r, ESP_FAIL, -1, "cancelled");
+    else complete_(r, ESP_ERR_TIMEOUT, -1, "deadline");
+  }
+
+  // Fails queued requests whose deadline passed (from poll() and the workers)
+  static void reap_(uint32_t now) {
+    if (!started_) return;
+    for (;;) {
+      Request *r = NULL;
+      portENTER_CRITICAL(&lock_);
+      for (int i=0;i<queueLen_ && !r;++i) {
+        if (slots_[i] && expired_(slots_[i], now)) { r = slots_[i]; slots_[i] = NULL; queued_--; unpair_(r); }
+      }
+      portEXIT_CRITICAL(&lock_);
+      if (!r) return;
+      abort_(r);
+    }
+  }
+
+  static uint32_t hedgeAfter_(const Request *r) {
+    uint32_t after = r->opts.hedgeAfterMs;
+    if (after != HEDGE_P95) return after;
+  #if ASYNCREQUEST_METRICS
+    uint8_t s = r->opts.metricsSlot < ASYNCREQUEST_METRIC_SLOTS ? r->opts.metricsSlot : 0;
+    portENTER_CRITICAL(&metricsLock_);
+    const Histogram &h = metrics_.slot[s].total;
+    after = h.count >= ASYNCREQUEST_HEDGE_MIN_SAMPLES ? h.percentile(95) : 0;
+    portEXIT_CRITICAL(&metricsLock_);
+    return after && after < ASYNCREQUEST_HEDGE_MIN_MS ? ASYNCREQUEST_HEDGE_MIN_MS : after;
+  #else
+    return 0;   // no latency data
+  #endif
+  }
+
+  // Queues a copy of r that another worker picks up once r has gone
+  // unanswered for its hedge budget (dropped unsent if r answers in time). Only into a free slot: a hedge never
+  // displaces other work.
+  static void hedge_(Request *r, uint32_t now) {
+    if (r->method != Method::GET || r->hedgeCopy || r->opts.connectOnly || workerCount_ < 2) return;
+    uint32_t after = hedgeAfter_(r);
+    if (!after || timeLeft_(r, now) <= after) return;
+    Request *h = acquire_();
+    prepare_(h, r->method, r->url, (const uint8_t*)r->payload.data(), r->payload.size(), r->headers.data(), r->nHeaders, r->opts);
+    h->opts.coalesceKey = 0; h->opts.hedgeAfterMs = 0; h->opts.pipeline = false;
+    h->originHash = r->originHash; h->t_enq = r->t_enq;
+    h->notBefore = (now + after) | 1;   // 0 means "due"
+    h->hedgeCopy = true;
+    bool queued = false;
+    portENTER_CRITICAL(&lock_);
+    for (int i=0;i<queueLen_ && !queued && !r->abort;++i) {
+      if (slots_[i]) continue;
+      h->id = r->id; h->seq = r->seq;
+      h->twin = r; r->twin = h;
+      slots_[i] = h; queued_++; queued = true;
+    }
+    portEXIT_CRITICAL(&lock_);
+    if (!queued) { release_(h); return; }
+    dispatch_(r->originHash);   // an idle worker re-arms its wait for it
+  }
+
+  // Adapts a BodySink to the Stream HTTPClient::writeToStream() expects
+  struct SinkStream : public Stream {
+    BodySink *sink; bool stopped;
+    explicit SinkStream(BodySink *s): sink(s), stopped(false) {}
+    size_t write(const uint8_t *data, size_t len) override {
+      if (stopped || !sink->write(data, len)) { stopped = true; return 0; }
+      return len;
+    }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
   };
 
   struct Origin { bool https; std::string host; uint16_t port; };
-  struct WorkerCtx {
+
+  // One warm connection: its own HTTPClient bound to its own socket, so
+  // switching origins never tears down (or re-handshakes) another origin.
+  struct Conn {
     HTTPClient http;          // persistent HTTPClient
     WiFiClient       *plain;  // owned when active
     WiFiClientSecure *secure; // owned when active
     bool hasOrigin;
+    bool collecting;          // http currently has response header keys set
     Origin origin;
-    std::string originKey;    // scheme:host:port
-    WorkerCtx(): plain(NULL), secure(NULL), hasOrigin(false) {
+    String hostArg;           // origin.host for HTTPClient::begin()
+    std::string prefix;       // the URLs' scheme://host[:port], as they spell it
+    uint32_t originHash;      // hashOrigin_() of the URLs it serves
+    uint32_t lastUse;
+    Conn(): plain(NULL), secure(NULL), hasOrigin(false), collecting(false), originHash(0), lastUse(0) {
       http.setReuse(true);
+  #if ASYNCREQUEST_FORCE_CLOSE
+      http.useHTTP10(true);
+  #else
+      http.useHTTP10(false);
+  #endif
+    }
+    ~Conn(){ resetClients(); }
+    bool connected() const { return (secure && secure->connected()) || (plain && plain->connected()); }
+    void stop() { if (secure) secure->stop(); else if (plain) plain->stop(); }   // unread response left
+    void resetClients(){ if(secure){ delete secure; secure=NULL;} if(plain){ delete plain; plain=NULL;} hasOrigin=false; collecting=false; prefix.clear(); }
+    // Compares the URL's origin in place, no parsing
+    bool serves(const Request *req) const {
+      const std::string &u = req->url;
+      size_t n = prefix.size();
+      return hasOrigin && originHash == req->originHash && u.size() >= n && u.compare(0, n, prefix) == 0 &&
+             (u.size() == n || u[n] == '/' || u[n] == '?');
+    }
+    const char *path(const Request *req) const { return req->url.size() > prefix.size() ? req->url.c_str() + prefix.size() : "/"; }
+  };
+
+  struct WorkerCtx {
+    Conn conns[ASYNCREQUEST_ORIGIN_CACHE];
+    std::string body;         // response buffer, reused across requests
+    std::string tx, line;     // pipelined request text / response header line
+
+    // Warm connection for the request's origin, else the least recently
+    // used slot; only the latter parses the URL
+    Conn &connFor(const Request *req) {
+      Conn *lru = &conns[0];
+      for (uint8_t i=0;i<ASYNCREQUEST_ORIGIN_CACHE;++i) {
+        Conn &c = conns[i];
+        if (c.serves(req)) return c;
+        if (!c.hasOrigin) { if (lru->hasOrigin) lru = &c; }
+        else if (lru->hasOrigin && c.lastUse < lru->lastUse) lru = &c;
+      }
+      lru->resetClients();
+      parseOrigin_(req->url, lru->origin, lru->prefix);
+      if (lru->origin.https) {
+        lru->secure = new WiFiClientSecure();
+        if (insecureTLS_ && lru->secure) lru->secure->setInsecure();
+      } else {
+        lru->plain = new WiFiClient();
+      }
+      lru->hostArg = lru->origin.host.c_str();
+      lru->originHash = req->originHash; lru->hasOrigin = true;
+      return *lru;
+    }
+
+    void warmOrigins(uint32_t *out) const {
+      for (uint8_t i=0;i<ASYNCREQUEST_ORIGIN_CACHE;++i)
+        out[i] = conns[i].hasOrigin && conns[i].connected() ? conns[i].originHash : 0;
+    }
+
+    void closeAll() {
+      for (uint8_t i=0;i<ASYNCREQUEST_ORIGIN_CACHE;++i) if (conns[i].hasOrigin) conns[i].resetClients();
+    }
+
+    // Releases sockets (and their TLS buffers) nobody used for a while
+    void closeIdle(uint32_t now) {
+      for (uint8_t i=0;i<ASYNCREQUEST_ORIGIN_CACHE;++i) {
+        Conn &c = conns[i];
+        if (c.hasOrigin && now - c.lastUse >= ASYNCREQUEST_ORIGIN_IDLE_MS) c.resetClients();
+      }
     }
-    ~WorkerCtx(){ resetClients(); }
-    void resetClients(){ if(secure){ delete secure; secure=NULL;} if(plain){ delete plain; plain=NULL;} hasOrigin=false; originKey.clear(); }
   };
 
-  static QueueHandle_t queue_;
   static bool started_;
+  static uint32_t linkEpoch_;      // bumped by dropConnections()
+  static bool deferCallbacks_;
+  static QueueHandle_t done_;
   static uint8_t maxWorkers_;
+  static uint32_t workerStack_;
+  static UBaseType_t workerPriority_;
+  static BaseType_t workerCore_;
   static bool insecureTLS_;
   static volatile uint32_t activeWorkers_;
 
+  // ───── metrics (all updates under metricsLock_, one short section each)
+#if ASYNCREQUEST_METRICS
+  static Metrics metrics_;
+  static portMUX_TYPE metricsLock_;
+#endif
+
+  static void countDispatch_(bool warm) {
+  #if ASYNCREQUEST_METRICS
+    portENTER_CRITICAL(&metricsLock_);
+    if (warm) metrics_.warmDispatches++; else metrics_.coldDispatches++;
+    portEXIT_CRITICAL(&metricsLock_);
+  #else
+    (void)warm;
+  #endif
+  }
+
+  static void countAbort_(uint8_t why) {
+  #if ASYNCREQUEST_METRICS
+    portENTER_CRITICAL(&metricsLock_);
+    if (why == ABORT_CANCEL) metrics_.cancelled++; else metrics_.deadlineMisses++;
+    portEXIT_CRITICAL(&metricsLock_);
+  #else
+    (void)why;
+  #endif
+  }
+
+  static void countHedge_(bool won) {
+  #if ASYNCREQUEST_METRICS
+    portENTER_CRITICAL(&metricsLock_);
+    if (won) metrics_.hedgeWins++; else metrics_.hedged++;
+    portEXIT_CRITICAL(&metricsLock_);
+  #else
+    (void)won;
+  #endif
+  }
+
+  static void countPipeline_(size_t answered, size_t fallbacks) {
+  #if ASYNCREQUEST_METRICS
+    portENTER_CRITICAL(&metricsLock_);
+    metrics_.pipelined += answered; metrics_.pipelineFallbacks += fallbacks;
+    portEXIT_CRITICAL(&metricsLock_);
+  #else
+    (void)answered; (void)fallbacks;
+  #endif
+  }
+
+  static void countEnqueue_(uint8_t depth, const char *dropped) {
+  #if ASYNCREQUEST_METRICS
+    portENTER_CRITICAL(&metricsLock_);
+    if (depth > metrics_.maxQueueDepth) metrics_.maxQueueDepth = depth;
+    if (dropped) { if (dropped[0] == 's') metrics_.superseded++; else metrics_.queueFull++; }
+    portEXIT_CRITICAL(&metricsLock_);
+  #else
+    (void)depth; (void)dropped;
+  #endif
+  }
+
+  struct Timing { uint32_t inQueue, connect, body, total; size_t in, out; };
+
+  static void record_(const Request *req, const Timing &t, int status, bool began, bool reused) {
+    if (began) GAME_TRACE(TR_DONE, req->opts.metricsSlot, status < 0 ? 0 : status, t.total);
+    else       GAME_TRACE(TR_BEGIN_FAIL, req->opts.metricsSlot, 0, t.total);
+  #if ASYNCREQUEST_METRICS
+    uint8_t s = req->opts.metricsSlot < ASYNCREQUEST_METRIC_SLOTS ? req->opts.metricsSlot : 0;
+    portENTER_CRITICAL(&metricsLock_);
+    Metrics &m = metrics_;
+    SlotMetrics &sm = m.slot[s];
+    m.requests++;
+    m.inQueue.add(t.inQueue);
+    sm.total.add(t.total);
+    if (!began) {
+      m.beginFail++; sm.errors++;
+    } else {
+      if (reused) m.reusedConnections++; else m.newConnections++;
+      m.connect.add(t.connect);
+      m.body.add(t.body);
+      if (status <= 0) sm.errors++;
+      else if (status >= 400) sm.httpErrors++;
+    }
+    m.bytesIn += t.in;  sm.bytesIn += t.in;
+    m.bytesOut += t.out; sm.bytesOut += t.out;
+    portEXIT_CRITICAL(&metricsLock_);
+  #else
+    (void)req; (void)t; (void)status; (void)began; (void)reused;
+  #endif
+  }
+
+  // Pool and completion queue keep their headroom over the queue length
+  static int scaled_(int base) { return base + (int)queueLen_ - ASYNCREQUEST_QUEUE_LEN; }
+
   static void init_() {
     if (started_) return;
-    queue_ = xQueueCreate(ASYNCREQUEST_QUEUE_LEN, sizeof(Request*));
-    if (!queue_) return;
+    int poolLen = scaled_(ASYNCREQUEST_POOL_LEN), doneLen = scaled_(ASYNCREQUEST_DONE_QUEUE_LEN);
+    slots_ = new Request*[queueLen_]();
+    poolLen_ = (uint16_t)(poolLen > 0 ? poolLen : 0);
+    pool_ = poolLen_ ? new Request[poolLen_] : NULL;
+    for (int i=poolLen_-1;i>=0;--i) { pool_[i].pooled = true; pool_[i].nextFree = freeList_; freeList_ = &pool_[i]; }
+    done_ = xQueueCreate(doneLen > 0 ? doneLen : 1, sizeof(Request*));
     for (uint8_t i=0;i<maxWorkers_;++i) {
       char name[12]; snprintf(name,sizeof(name),"reqW%u", i);
-      xTaskCreatePinnedToCore(worker_, name, ASYNCREQUEST_WORKER_STACK, NULL, tskIDLE_PRIORITY+1, NULL, 1);
+      WorkerSlot &w = workers_[workerCount_];
+      w.idle = false;   // becomes idle in its first dequeue_()
+      memset(w.warm, 0, sizeof(w.warm));
+      if (xTaskCreatePinnedToCore(worker_, name, workerStack_, (void*)(uintptr_t)workerCount_,
+                                  workerPriority_, &w.task, workerCore_) == pdPASS) workerCount_++;
     }
     started_ = true;
   }
 
-  static bool parseOrigin_(const std::string &url, Origin &o, std::string &key) {
+  static bool parseOrigin_(const std::string &url, Origin &o, std::string &prefix) {
     size_t posScheme = url.find("://");
     std::string scheme = posScheme!=std::string::npos ? url.substr(0,posScheme) : "";
     o.https = (scheme == "https" || scheme == "HTTPS");
@@ -142,116 +1042,502 @@ private:
       o.host = hostport;
       o.port = o.https ? 443 : 80;
     }
-    if (o.host.empty()) return false;
-    key.clear();
-    key.append(o.https?"s:":"h:").append(o.host).append(":");
-    char num[8]; snprintf(num,sizeof(num),"%u", (unsigned)o.port); key.append(num);
-    return true;
+    prefix.assign(url, 0, pathStart);
+    return !o.host.empty();
   }
 
-  static void worker_(void *arg) {
-    (void)arg;
-    WorkerCtx ctx;
-  #if ASYNCREQUEST_FORCE_CLOSE
-    ctx.http.useHTTP10(true);
+  // ───── DNS cache: addresses shared by all workers (guarded by lock_), so a
+  // reconnect goes straight to TCP. Lookups run outside the lock; one that
+  // fails keeps serving the old address, a connect that fails drops it.
+#if ASYNCREQUEST_DNS_CACHE
+  struct DnsEntry { char host[64]; IPAddress ip; uint32_t at; };   // host[0]==0: free
+  static DnsEntry dns_[ASYNCREQUEST_DNS_CACHE];
+
+  static int findDns_(const char *host) {
+    for (uint8_t i=0;i<ASYNCREQUEST_DNS_CACHE;++i) if (dns_[i].host[0] && strcmp(dns_[i].host, host) == 0) return i;
+    return -1;
+  }
+#endif
+
+  enum DnsEvent { DNS_HIT, DNS_LOOKUP, DNS_STALE };
+  static void countDns_(DnsEvent e) {
+  #if ASYNCREQUEST_METRICS
+    portENTER_CRITICAL(&metricsLock_);
+    if (e == DNS_HIT) metrics_.dnsHits++; else if (e == DNS_LOOKUP) metrics_.dnsLookups++; else metrics_.dnsStale++;
+    portEXIT_CRITICAL(&metricsLock_);
   #else
-    ctx.http.useHTTP10(false);
+    (void)e;
   #endif
-    for(;;){
-      Request *req=NULL;
-      if (xQueueReceive(queue_, &req, portMAX_DELAY) != pdTRUE || !req) continue;
-      activeWorkers_++;
-      uint32_t t_start = millis();
+  }
 
-      // Prepare origin / client reuse
-      Origin want; std::string wantKey;
-      parseOrigin_(req->url, want, wantKey);
-      if (!ctx.hasOrigin || wantKey != ctx.originKey) {
-        ctx.resetClients();
-        if (want.https) {
-          ctx.secure = new WiFiClientSecure();
-          if (insecureTLS_ && ctx.secure) ctx.secure->setInsecure();
-        } else {
-          ctx.plain = new WiFiClient();
-        }
-        ctx.origin = want; ctx.originKey = wantKey; ctx.hasOrigin = true;
+  // Address for host: literal, cached, resolved now, or the stale entry
+  static bool resolve_(const std::string &host, IPAddress &ip) {
+#if ASYNCREQUEST_DNS_CACHE
+    if (ip.fromString(host.c_str())) return true;
+    if (host.size() >= sizeof(dns_[0].host)) return false;
+    uint32_t now = millis();
+    bool have = false, fresh = false;
+    portENTER_CRITICAL(&lock_);
+    int i = findDns_(host.c_str());
+    if (i >= 0) { ip = dns_[i].ip; have = true; fresh = now - dns_[i].at < ASYNCREQUEST_DNS_TTL_MS; }
+    portEXIT_CRITICAL(&lock_);
+    if (fresh) { countDns_(DNS_HIT); return true; }
+
+    IPAddress got;
+    if (WiFi.hostByName(host.c_str(), got) != 1 || !(uint32_t)got) {
+      if (have) countDns_(DNS_STALE);
+      AR_LOGf("[AsyncRequest] DNS %s failed%s\n", host.c_str(), have ? ", using the cached address" : "");
+      return have;
+    }
+    countDns_(DNS_LOOKUP);
+    ip = got;
+    portENTER_CRITICAL(&lock_);
+    i = findDns_(host.c_str());
+    if (i < 0) {   // a free entry, else the oldest
+      i = 0;
+      for (uint8_t k=1;k<ASYNCREQUEST_DNS_CACHE;++k) {
+        if (!dns_[i].host[0]) break;
+        if (!dns_[k].host[0] || dns_[k].at - dns_[i].at > 0x80000000u) i = k;
       }
+      memcpy(dns_[i].host, host.c_str(), host.size() + 1);
+    }
+    dns_[i].ip = got; dns_[i].at = now;
+    portEXIT_CRITICAL(&lock_);
+    return true;
+#else
+    (void)host; (void)ip;
+    return false;
+#endif
+  }
+
+  // The address stopped answering: forget it, so neither a failed lookup nor
+  // another worker falls back to it
+  static void dropDns_(const std::string &host) {
+#if ASYNCREQUEST_DNS_CACHE
+    portENTER_CRITICAL(&lock_);
+    int i = findDns_(host.c_str());
+    if (i >= 0) dns_[i].host[0] = 0;
+    portEXIT_CRITICAL(&lock_);
+#else
+    (void)host;
+#endif
+  }
+
+  // To ip, or by name without one (TLS keeps the hostname for SNI)
+  static bool connectTo_(Conn &conn, const IPAddress *ip, uint32_t timeoutMs) {
+    const Origin &o = conn.origin;
+    int32_t ms = (int32_t)timeoutMs;
+    if (conn.secure) {
+      // WiFiClientSecure::connect() is not virtual, so call it on its own
+      // type; connect(ip, port, host, ...) waits for the Stream timeout
+      Stream *stream = conn.secure;
+      unsigned long was = stream->getTimeout();
+      stream->setTimeout(timeoutMs);
+      bool ok = (ip ? conn.secure->connect(*ip, o.port, o.host.c_str(), NULL, NULL, NULL)
+                    : conn.secure->connect(o.host.c_str(), o.port, ms)) > 0;
+      stream->setTimeout(was);
+      return ok;
+    }
+    return conn.plain && (ip ? conn.plain->connect(*ip, o.port, ms) : conn.plain->connect(o.host.c_str(), o.port, ms)) > 0;
+  }
 
-      // Begin request
-      bool began=false; uint32_t t0 = millis();
-      if (ctx.hasOrigin) {
+  // Connects conn's socket within timeoutMs: to the cached address, and once
+  // by name with the time left when that address did not answer or none is
+  // known. HTTPClient then finds it connected; on false the caller fails
+  // the request, nothing retries.
+  static bool open_(Conn &conn, uint32_t timeoutMs) {
+    if (!timeoutMs) return false;
+    uint32_t t0 = millis();
+    IPAddress ip;
+    if (resolve_(conn.origin.host, ip)) {
+      if (connectTo_(conn, &ip, timeoutMs)) return true;
+      dropDns_(conn.origin.host);
+      uint32_t used = millis() - t0;
+      if (used >= timeoutMs) return false;   // out of time: no name connect
+      timeoutMs -= used;
+    }
+    return connectTo_(conn, NULL, timeoutMs);
+  }
+
+  // One request through HTTPClient on the origin's warm connection
+  static void perform_(WorkerCtx &ctx, Request *req, uint32_t t_start) {
+    // Pick the warm connection for this origin (or open one)
+    Conn &conn = ctx.connFor(req);
+    conn.lastUse = t_start;
+    HTTPClient &http = conn.http;
+
+    // Begin request (long-polls ask for a longer idle timeout; a deadline
+    // caps both timeouts)
+    uint32_t idleTimeout = req->opts.timeoutMs ? req->opts.timeoutMs : ASYNCREQUEST_IDLE_TIMEOUT_MS;
+    uint32_t connectTimeout = ASYNCREQUEST_CONNECT_TIMEOUT_MS;
+    uint32_t left = timeLeft_(req, t_start);
+    if (idleTimeout > left) idleTimeout = left;
+    if (connectTimeout > left) connectTimeout = left;
+    if (idleTimeout > 0xFFFF) idleTimeout = 0xFFFF; // HTTPClient::setTimeout is 16-bit
+    bool began=false, opened=true;
+    // HTTPClient keeps the socket when the previous response allowed it
+    bool reused = conn.connected();
+    if (conn.hasOrigin) {
   #if ASYNCREQUEST_FORCE_CLOSE
-        ctx.http.addHeader("Connection","close");
+      http.addHeader("Connection","close");
   #endif
-  ctx.http.setConnectTimeout(ASYNCREQUEST_CONNECT_TIMEOUT_MS);
-  ctx.http.setTimeout(ASYNCREQUEST_IDLE_TIMEOUT_MS); // was 7000ms, align with ~10s request
-        if (ctx.origin.https && ctx.secure) began = ctx.http.begin(*ctx.secure, req->url.c_str());
-        else if (!ctx.origin.https && ctx.plain) began = ctx.http.begin(*ctx.plain, req->url.c_str());
-      }
+  http.setConnectTimeout(connectTimeout);
+  http.setTimeout(idleTimeout); // was 7000ms, align with ~10s request
+      // Origin already split: HTTPClient only gets host, port and path
+      if (conn.origin.https && conn.secure) began = http.begin(*conn.secure, conn.hostArg, conn.origin.port, conn.path(req), true);
+      else if (!conn.origin.https && conn.plain) began = http.begin(*conn.plain, conn.hostArg, conn.origin.port, conn.path(req), false);
+      if (began && !reused) opened = open_(conn, connectTimeout);
+    }
 
-      int status=-1; esp_err_t err=ESP_OK; std::string body; uint32_t t1=millis();
-      if (began) {
-        for(auto &h: req->headers) ctx.http.addHeader(String(h.first.c_str()), String(h.second.c_str()));
-        int code;
-        if (req->method == Method::POST) {
-          if (!req->payload.empty()) code = ctx.http.POST((uint8_t*)req->payload.data(), req->payload.size());
-          else                       code = ctx.http.POST((uint8_t*)NULL,0);
-        } else {
-          code = ctx.http.GET();
+    int status=-1; esp_err_t err=ESP_OK; uint32_t t1=millis();
+    bool aborted = false;   // cancel() or the deadline hit while the body streamed
+    Timing tm = { t_start - req->t_enq, 0, 0, 0, 0, began ? req->payload.size() : 0 };
+    std::string &body = ctx.body; body.clear();
+    if (began) {
+      for (uint8_t i=0;i<req->nHeaders;++i) http.addHeader(String(req->headers[i].first.c_str()), String(req->headers[i].second.c_str()));
+      if (req->opts.collectCount || conn.collecting) {
+        http.collectHeaders(req->opts.collectHeaders, req->opts.collectCount);
+        conn.collecting = req->opts.collectCount > 0;
+      }
+      int code;
+      if (!opened) {
+        code = HTTPC_ERROR_CONNECTION_REFUSED;   // open_() already tried by name
+      } else if (req->method == Method::POST) {
+        if (!req->payload.empty()) code = http.POST((uint8_t*)req->payload.data(), req->payload.size());
+        else                       code = http.POST((uint8_t*)NULL,0);
+      } else {
+        code = http.GET();
+      }
+      uint32_t t2 = millis();
+      bool stop = stopped_(req, t2);
+      if (!settle_(req, code > 0 || stop)) {
+        // Hedged: the twin answered first, or carries on after this failure
+        http.end();
+        if (code > 0) conn.stop();
+        release_(req);
+        return;
+      }
+      if (stop) {   // cancelled or out of time while waiting for the response
+        http.end();
+        if (code > 0) conn.stop();
+        abort_(req);
+        return;
+      }
+      if (code > 0) {
+        status = code;
+        for (size_t i=0;i<req->opts.collectCount;++i) {
+          const char *key = req->opts.collectHeaders[i];
+          if (http.hasHeader(key)) req->respHeaders.push_back(std::make_pair(std::string(key), std::string(http.header(key).c_str())));
         }
-        uint32_t t2 = millis();
-        if (code > 0) {
-          status = code;
-          if (code != HTTP_CODE_NO_CONTENT) {
-            int len = ctx.http.getSize();
-            WiFiClient *stream = ctx.http.getStreamPtr();
-            if (len > 0 && stream) {
-              // known length
-              body.reserve(len < (int)ASYNCREQUEST_BODY_CAP_BYTES ? (size_t)len : 1024);
-              size_t readTot=0; uint32_t lastAct = millis();
-              while (readTot < (size_t)len && ctx.http.connected()) {
-                size_t avail = stream->available();
-                if (!avail) { if (millis()-lastAct > ASYNCREQUEST_IDLE_TIMEOUT_MS) break; vTaskDelay(2); continue; }
-                uint8_t buf[512]; size_t wantSz = avail > sizeof(buf)? sizeof(buf): avail;
-                size_t n = stream->readBytes(buf, wantSz); if(!n) continue; lastAct = millis(); readTot += n;
-                size_t room = ASYNCREQUEST_BODY_CAP_BYTES - body.size(); if (!room) break; size_t take = n < room? n: room; body.append((char*)buf, take); if (take < n) break;
-              }
-            } else {
-              // unknown length (chunked) fallback
-              String tmp = ctx.http.getString();
-              if (tmp.length() > (int)ASYNCREQUEST_BODY_CAP_BYTES) tmp.remove(ASYNCREQUEST_BODY_CAP_BYTES);
-              body.assign(tmp.c_str(), tmp.length());
+        if (code != HTTP_CODE_NO_CONTENT && code != HTTP_CODE_NOT_MODIFIED) {
+          BodySink *sink = (code >= 200 && code < 300) ? req->opts.sink : NULL;
+          int len = http.getSize();
+          WiFiClient *stream = http.getStreamPtr();
+          if (sink) sink->begin(code);
+          if (len > 0 && stream) {
+            // known length
+            if (!sink) body.reserve(len < (int)ASYNCREQUEST_BODY_CAP_BYTES ? (size_t)len : 1024);
+            size_t readTot=0; uint32_t lastAct = millis(); bool more = true;
+            while (more && readTot < (size_t)len && http.connected()) {
+              if (stopped_(req, millis())) { aborted = true; break; }
+              size_t avail = stream->available();
+              if (!avail) { if (millis()-lastAct > idleTimeout) break; vTaskDelay(2); continue; }
+              uint8_t buf[512]; size_t wantSz = avail > sizeof(buf)? sizeof(buf): avail;
+              size_t n = stream->readBytes(buf, wantSz); if(!n) continue; lastAct = millis(); readTot += n;
+              if (sink) { more = sink->write(buf, n); continue; }
+              size_t room = ASYNCREQUEST_BODY_CAP_BYTES - body.size(); if (!room) break; size_t take = n < room? n: room; body.append((char*)buf, take); if (take < n) break;
             }
+            if (sink) sink->end(readTot == (size_t)len);
+            tm.in = readTot;
+          } else if (sink) {
+            // unknown length (chunked): HTTPClient de-chunks into the sink
+            SinkStream out(sink);
+            int n = http.writeToStream(&out);
+            sink->end(n >= 0 && !out.stopped);
+            if (n > 0) tm.in = (size_t)n;
+          } else {
+            // unknown length (chunked) fallback
+            String tmp = http.getString();
+            if (tmp.length() > (int)ASYNCREQUEST_BODY_CAP_BYTES) tmp.remove(ASYNCREQUEST_BODY_CAP_BYTES);
+            body.assign(tmp.c_str(), tmp.length());
+            tm.in = body.size();
           }
-        } else {
-          err = ESP_FAIL;
         }
+      } else {
+        err = ESP_FAIL;
+      }
   uint32_t t3 = millis();
-  ctx.http.end(); // will keep socket if reuse & server allowed keep-alive
+  http.end(); // will keep socket if reuse & server allowed keep-alive
+  if (aborted) conn.stop();
+  tm.connect = t2 - t1; tm.body = t3 - t2; tm.total = t3 - t_start;
   if (ASYNCREQUEST_DEBUG) {
     AR_LOGf("[TIMING] method=%s url=%s | inQ=%lums | conn+tls+hdr=%lums | body=%lums | total=%lums | status=%d | bodyB=%u | active=%u\n",
-      req->method==Method::GET?"GET":"POST", req->url.c_str(),
-      (unsigned long)(t_start - req->t_enq),
-      (unsigned long)(t2 - t1),
-      (unsigned long)(t3 - t2),
-      (unsigned long)(t3 - t_start),
-      status, (unsigned)body.size(), (unsigned)activeWorkers_);
+    req->method==Method::GET?"GET":"POST", req->url.c_str(),
+    (unsigned long)(t_start - req->t_enq),
+    (unsigned long)(t2 - t1),
+    (unsigned long)(t3 - t2),
+    (unsigned long)(t3 - t_start),
+    status, (unsigned)body.size(), (unsigned)activeWorkers_);
   }
-      } else {
-        err = ESP_FAIL; uint32_t t3=millis();
-        if (ASYNCREQUEST_DEBUG) {
+    } else {
+      err = ESP_FAIL; uint32_t t3=millis();
+      tm.total = t3 - t_start;
+      if (ASYNCREQUEST_DEBUG) {
     AR_LOGf("[TIMING] method=%s url=%s | inQ=%lums | beginFail | total=%lums | active=%u\n",
-      req->method==Method::GET?"GET":"POST", req->url.c_str(),
-      (unsigned long)(t_start-req->t_enq), (unsigned long)(t3-t_start), (unsigned)activeWorkers_);
+    req->method==Method::GET?"GET":"POST", req->url.c_str(),
+    (unsigned long)(t_start-req->t_enq), (unsigned long)(t3-t_start), (unsigned)activeWorkers_);
+      }
+    }
+    record_(req, tm, status, began, reused);
+    if (aborted) { abort_(req); return; }
+    if (!began && !settle_(req, false)) { release_(req); return; }
+    complete_(req, err, status, body);
+  }
+
+  // prewarm(): connect the origin's socket and leave it for the next request
+  static void connectOnly_(WorkerCtx &ctx, Request *req, uint32_t t_start) {
+    Conn &conn = ctx.connFor(req);
+    const Origin &want = conn.origin;
+    conn.lastUse = t_start;
+    bool reused = conn.connected();
+    uint32_t connectTimeout = ASYNCREQUEST_CONNECT_TIMEOUT_MS;
+    uint32_t left = timeLeft_(req, t_start);
+    if (connectTimeout > left) connectTimeout = left;
+    bool ok = !want.host.empty() && (reused || open_(conn, connectTimeout));
+    uint32_t t2 = millis();
+    Timing tm = { t_start - req->t_enq, t2 - t_start, 0, t2 - t_start, 0, 0 };
+    record_(req, tm, ok ? 200 : -1, ok, reused);
+    AR_LOGf("[AsyncRequest] prewarm %s %s in %lums\n", want.host.c_str(), ok ? (reused ? "already open" : "connected") : "FAILED",
+            (unsigned long)(t2 - t_start));
+    ctx.body.clear();
+    complete_(req, ok ? ESP_OK : ESP_FAIL, ok ? 200 : -1, ctx.body);
+  }
+
+  // A pipelined request that is not re-sent: no connection, or its bytes
+  // went out and the server may already have applied it
+  static void failPipelined_(Request *req, uint32_t t_start, uint32_t now) {
+    if (!settle_(req, false)) { release_(req); return; }   // the hedged twin carries on
+    Timing tm = { t_start - req->t_enq, now - t_start, 0, now - t_start, 0, 0 };
+    record_(req, tm, -1, true, false);
+    complete_(req, ESP_FAIL, -1, "");
+  }
+
+  // ───── pipelining: raw HTTP/1.1 on the connection HTTPClient also uses
+  struct RespReader {
+    WiFiClient *c; uint32_t timeout;
+    int get() {
+      uint32_t t0 = millis();
+      while (!c->available()) {
+        if (!c->connected() || millis() - t0 > timeout) return -1;
+        vTaskDelay(1);
+      }
+      return c->read();
+    }
+    bool line(std::string &out) {
+      out.clear();
+      for (;;) {
+        int ch = get(); if (ch < 0) return false;
+        if (ch == '\n') { if (!out.empty() && out[out.size()-1] == '\r') out.erase(out.size()-1); return true; }
+        if (out.size() < 512) out.push_back((char)ch);
+      }
+    }
+    // Appends up to the body cap, discards the rest; false on EOF/timeout
+    bool bytes(std::string &body, size_t n) {
+      uint8_t buf[512];
+      while (n) {
+        uint32_t t0 = millis();
+        while (!c->available()) {
+          if (!c->connected() || millis() - t0 > timeout) return false;
+          vTaskDelay(1);
         }
+        size_t want = n < sizeof(buf) ? n : sizeof(buf);
+        size_t got = c->readBytes(buf, want); if (!got) continue;
+        size_t room = ASYNCREQUEST_BODY_CAP_BYTES - body.size();
+        body.append((char*)buf, got < room ? got : room);
+        n -= got;
       }
+      return true;
+    }
+  };
+
+  static bool headerIs_(const std::string &line, size_t colon, const char *name) {
+    return strlen(name) == colon && strncasecmp(line.c_str(), name, colon) == 0;
+  }
+
+  // Status line, headers (Content-Length / chunked / Connection) and body
+  static bool readResponse_(RespReader &rd, std::string &line, std::string &body, int &status, bool &keepAlive) {
+    body.clear();
+    if (!rd.line(line) || line.compare(0, 5, "HTTP/") != 0) return false;
+    size_t sp = line.find(' ');
+    if (sp == std::string::npos) return false;
+    status = atoi(line.c_str() + sp + 1);
+    keepAlive = line.compare(0, 8, "HTTP/1.1") == 0;
+    long len = -1; bool chunked = false;
+    for (;;) {
+      if (!rd.line(line)) return false;
+      if (line.empty()) break;
+      size_t colon = line.find(':');
+      if (colon == std::string::npos) continue;
+      const char *v = line.c_str() + colon + 1;
+      while (*v == ' ') ++v;
+      if (headerIs_(line, colon, "Content-Length")) len = atol(v);
+      else if (headerIs_(line, colon, "Transfer-Encoding")) chunked = strstr(v, "chunked") != NULL;
+      else if (headerIs_(line, colon, "Connection")) keepAlive = strncasecmp(v, "close", 5) != 0;
+    }
+    if (status == HTTP_CODE_NO_CONTENT || status == HTTP_CODE_NOT_MODIFIED) return true;
+    if (chunked) {
+      for (;;) {
+        if (!rd.line(line)) return false;
+        size_t n = strtoul(line.c_str(), NULL, 16);
+        if (!n) { do { if (!rd.line(line)) return false; } while (!line.empty()); return true; }
+        if (!rd.bytes(body, n) || !rd.line(line)) return false;
+      }
+    }
+    if (len < 0) return false;   // close-delimited bodies can't be pipelined
+    return rd.bytes(body, (size_t)len);
+  }
+
+  static void appendRequest_(std::string &tx, const Request *r, const Conn &conn) {
+    const Origin &o = conn.origin;
+    char num[12];
+    tx.append(r->method == Method::GET ? "GET " : "POST ").append(conn.path(r));
+    tx.append(" HTTP/1.1\r\nHost: ").append(o.host);
+    if (o.port != (o.https ? 443 : 80)) { snprintf(num, sizeof(num), ":%u", (unsigned)o.port); tx.append(num); }
+    tx.append("\r\nUser-Agent: ESP32HTTPClient\r\nConnection: keep-alive\r\n");
+    if (r->method == Method::POST) {
+      snprintf(num, sizeof(num), "%u", (unsigned)r->payload.size());
+      tx.append("Content-Length: ").append(num).append("\r\n");
+    }
+    for (uint8_t i=0;i<r->nHeaders;++i) tx.append(r->headers[i].first).append(": ").append(r->headers[i].second).append("\r\n");
+    tx.append("\r\n").append(r->payload);
+  }
+
+  // Writes all requests in one go and reads the responses in order. Of what
+  // is left unanswered (socket closed, Connection: close, parse error), GETs
+  // and requests never written go through perform_() one by one; a POST the
+  // server may have seen fails, and its caller decides about a retry.
+  static void pipeline_(WorkerCtx &ctx, Request **batch, size_t n, uint32_t t_start) {
+    size_t live = 0;
+    uint32_t readTimeout = ASYNCREQUEST_IDLE_TIMEOUT_MS;   // both capped by the nearest deadline
+    uint32_t connectTimeout = ASYNCREQUEST_CONNECT_TIMEOUT_MS;
+    for (size_t i=0;i<n;++i) {
+      if (stopped_(batch[i], t_start)) { abort_(batch[i]); continue; }
+      uint32_t left = timeLeft_(batch[i], t_start);
+      if (left < readTimeout) readTimeout = left;
+      if (left < connectTimeout) connectTimeout = left;
+      batch[live++] = batch[i];
+    }
+    n = live;
+    if (!n) return;
+    Conn &conn = ctx.connFor(batch[0]);
+    conn.lastUse = t_start;
+    WiFiClient *cl = conn.secure ? conn.secure : conn.plain;
+
+    uint32_t t1 = millis();
+    bool reused = cl && cl->connected();
+    bool opened = cl && (reused || open_(conn, connectTimeout));
+    bool ok = opened;
+    size_t at[ASYNCREQUEST_PIPELINE_MAX];   // offset of each request in tx
+    size_t written = 0;
+    if (ok) {
+      ctx.tx.clear();
+      for (size_t i=0;i<n;++i) { at[i] = ctx.tx.size(); appendRequest_(ctx.tx, batch[i], conn); }
+      written = cl->write((const uint8_t*)ctx.tx.data(), ctx.tx.size());
+      ok = written == ctx.tx.size();
+    }
+    uint32_t t2 = millis();
+
+    size_t answered = 0;
+    bool keepAlive = ok;
+    RespReader rd = { cl, readTimeout };
+    while (ok && keepAlive && answered < n) {
+      Request *r = batch[answered];
+      int status = -1;
+      if (!readResponse_(rd, ctx.line, ctx.body, status, keepAlive)) { keepAlive = false; break; }
+      uint32_t t3 = millis();
+      Timing tm = { t_start - r->t_enq, t2 - t1, t3 - t2, t3 - t_start, ctx.body.size(), r->payload.size() };
+      record_(r, tm, status, true, reused || answered > 0);
+      complete_(r, ESP_OK, status, ctx.body);
+      ++answered;
+    }
+    if (cl && !keepAlive) cl->stop();
+    GAME_TRACE(TR_PIPELINE, answered, n);
+
+    size_t resent = 0;
+    for (size_t i=answered;i<n;++i) {
+      uint32_t now = millis();
+      // One connect per batch, not one per request
+      bool resend = opened && (batch[i]->method == Method::GET || at[i] >= written);
+      if (stopped_(batch[i], now)) abort_(batch[i]);
+      else if (resend) { perform_(ctx, batch[i], now); ++resent; }
+      else failPipelined_(batch[i], t_start, now);
+    }
+    countPipeline_(answered, resent);
+    if (answered < n) {
+      AR_LOGf("[AsyncRequest] pipeline: %u/%u answered, %u re-sent\n", (unsigned)answered, (unsigned)n, (unsigned)resent);
+    }
+  }
+
+  static void worker_(void *arg) {
+    uint8_t self = (uint8_t)(uintptr_t)arg;
+    WorkerCtx ctx;
+    uint32_t warm[ASYNCREQUEST_ORIGIN_CACHE];
+    Request *batch[ASYNCREQUEST_PIPELINE_MAX];
+    uint32_t epoch = __atomic_load_n(&linkEpoch_, __ATOMIC_SEQ_CST);
+    for(;;){
+      uint32_t link = __atomic_load_n(&linkEpoch_, __ATOMIC_SEQ_CST);
+      if (link != epoch) { epoch = link; ctx.closeAll(); }   // sockets from before a link drop
+      ctx.warmOrigins(warm);
+      uint32_t now = millis(), wait = ASYNCREQUEST_ORIGIN_IDLE_MS;
+      reap_(now);
+      Request *req = dequeue_(self, warm, now, wait);
+      if (!req) {
+        if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait))) ctx.closeIdle(millis());
+        continue;
+      }
+      activeWorkers_++;
+      uint32_t t_start = millis();
+      ctx.closeIdle(t_start);
+      size_t n = 1;
+      batch[0] = req;
+      if (pipelinable_(req)) n += gather_(self, req, batch + 1, ASYNCREQUEST_PIPELINE_MAX - 1);
+      if (n > 1) pipeline_(ctx, batch, n, t_start);
+      else if (stopped_(req, t_start)) abort_(req);
+      else if (req->opts.connectOnly) connectOnly_(ctx, req, t_start);
+      else {
+        if (req->hedgeCopy) countHedge_(false);   // its original is overdue
+        else hedge_(req, t_start);
+        perform_(ctx, req, t_start);
+      }
+      activeWorkers_--;
+    }
+  }
+
+  // Hands a finished request to its callback: inline, or via the completion
+  // queue when deferred (falls back to inline if the queue is full/missing).
+  // body is the worker's buffer; it may be swapped or moved out, the worker
+  // clears it before the next response anyway.
+  static void complete_(Request *req, esp_err_t err, int status, std::string &body) {
+    if (deferCallbacks_ && done_) {
+      req->err = err; req->status = status;
+      req->respBody.swap(body);   // both buffers keep their capacity
+      if (xQueueSend(done_, &req, 0) == pdTRUE) return;
+      AR_LOGf("[AsyncRequest] completion queue full, running callback inline\n");
+      finish_(req, err, status, req->respBody);
+    } else {
       finish_(req, err, status, body);
-      delete req; activeWorkers_--;
     }
+    release_(req);
+  }
+  static void complete_(Request *req, esp_err_t err, int status, const char *reason) {
+    std::string body(reason);   // short reasons fit the small-string buffer
+    complete_(req, err, status, body);
   }
 
   static void finish_(Request *req, esp_err_t err, int status, std::string &body) {
-    if (req->cb) req->cb(err,status,body);
+    if (req->vcb) req->vcb(err,status,(const uint8_t*)body.data(),body.size());
+    else if (req->cb) req->cb(err,status,std::move(body));
+    else if (req->hcb) req->hcb(err,status,std::move(body),req->respHeaders);
   }
 };
 
@@ -0,0 +1,132 @@
+// Logging for ESPGameAPI / AsyncRequest
+//
+// Text logs (GAME_LOG) exist only with -DESPGAMEAPI_ENABLE_SERIAL; otherwise
+// the call sits in a dead branch and its arguments are never evaluated.
+// Per-request events go to a binary ring (GAME_TRACE) instead of being
+// formatted: 12 bytes each, recorded in a few cycles, printed on demand with
+// TraceLog::dump(Serial).
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+#ifdef ESPGAMEAPI_ENABLE_SERIAL
+  #define GAME_LOG(...)  Serial.printf(__VA_ARGS__)
+#else
+  // dead branch: arguments are type-checked but never evaluated
+  #define GAME_LOG(...)  do{ if (0) Serial.printf(__VA_ARGS__); }while(0)
+#endif
+
+// Events kept in the trace ring (0 = compiled out). On by default together
+// with the text logs.
+#ifndef ESPGAMEAPI_TRACE_LEN
+  #ifdef ESPGAMEAPI_ENABLE_SERIAL
+    #define ESPGAMEAPI_TRACE_LEN 64
+  #else
+    #define ESPGAMEAPI_TRACE_LEN 0
+  #endif
+#endif
+
+// Event ids; a/b/v meaning per event is listed in TraceLog::name()
+enum TraceEvent : uint8_t {
+  TR_ENQUEUE = 1,     // a = slot, b = queue depth
+  TR_DROP,            // a = slot, b = 0 queue full / 1 superseded
+  TR_DONE,            // a = slot, b = HTTP status, v = total ms
+  TR_BEGIN_FAIL,      // a = slot, v = total ms
+  TR_PIPELINE,        // a = answered, b = sent
+  TR_CONN_STATE,      // a = ConnectionState
+  TR_AUTH_EXPIRED,
+  TR_POLL,            // a = production, b = consumption entries, v = buildings
+  TR_PAUSED,
+  TR_MALFORMED,
+  TR_HOLD_OFF,        // b = HTTP status, v = ms
+  TR_BACKLOG,         // b = samples uploaded
+  TR_FAILED,          // a = endpoint, b = HTTP status (0 = network), v = esp_err_t
+};
+
+class TraceLog {
+public:
+  struct Event { uint32_t t_ms; uint8_t id; uint8_t a; uint16_t b; int32_t v; };
+
+  static void record(uint8_t id, uint8_t a = 0, uint16_t b = 0, int32_t v = 0) {
+  #if ESPGAMEAPI_TRACE_LEN
+    portENTER_CRITICAL(&lock_);
+    Event &e = ring_[next_ % ESPGAMEAPI_TRACE_LEN];
+    e.t_ms = millis(); e.id = id; e.a = a; e.b = b; e.v = v;
+    next_++;
+    portEXIT_CRITICAL(&lock_);
+  #else
+    (void)id; (void)a; (void)b; (void)v;
+  #endif
+  }
+
+  // Copies up to max of the newest events, oldest first
+  static size_t snapshot(Event *out, size_t max) {
+  #if ESPGAMEAPI_TRACE_LEN
+    portENTER_CRITICAL(&lock_);
+    size_t n = next_ < ESPGAMEAPI_TRACE_LEN ? next_ : ESPGAMEAPI_TRACE_LEN;
+    if (n > max) n = max;
+    for (size_t i = 0; i < n; i++) out[i] = ring_[(next_ - n + i) % ESPGAMEAPI_TRACE_LEN];
+    portEXIT_CRITICAL(&lock_);
+    return n;
+  #else
+    (void)out; (void)max;
+    return 0;
+  #endif
+  }
+
+  // Formats the ring; the only place trace events become text
+  static void dump(Print &out) {
+  #if ESPGAMEAPI_TRACE_LEN
+    static Event copy[ESPGAMEAPI_TRACE_LEN];
+    size_t n = snapshot(copy, ESPGAMEAPI_TRACE_LEN);
+    out.printf("=== Trace (%u events, %u total) ===\n", (unsigned)n, (unsigned)next_);
+    for (size_t i = 0; i < n; i++) {
+      const Event &e = copy[i];
+      out.printf("%10u ms  %-12s a=%u b=%u v=%d\n", (unsigned)e.t_ms, name(e.id),
+                 (unsigned)e.a, (unsigned)e.b, (int)e.v);
+    }
+  #else
+    out.println("Trace disabled (ESPGAMEAPI_TRACE_LEN=0)");
+  #endif
+  }
+
+  static void clear() {
+  #if ESPGAMEAPI_TRACE_LEN
+    portENTER_CRITICAL(&lock_);
+    next_ = 0;
+    portEXIT_CRITICAL(&lock_);
+  #endif
+  }
+
+  static const char *name(uint8_t id) {
+    switch (id) {
+      case TR_ENQUEUE:      return "enqueue";
+      case TR_DROP:         return "drop";
+      case TR_DONE:         return "done";
+      case TR_BEGIN_FAIL:   return "begin_fail";
+      case TR_PIPELINE:     return "pipeline";
+      case TR_CONN_STATE:   return "conn_state";
+      case TR_AUTH_EXPIRED: return "auth_expired";
+      case TR_POLL:         return "poll";
+      case TR_PAUSED:       return "paused";
+      case TR_MALFORMED:    return "malformed";
+      case TR_HOLD_OFF:     return "hold_off";
+      case TR_BACKLOG:      return "backlog";
+      case TR_FAILED:       return "failed";
+      default:              return "?";
+    }
+  }
+
+private:
+#if ESPGAMEAPI_TRACE_LEN
+  static Event ring_[ESPGAMEAPI_TRACE_LEN];
+  static uint32_t next_;
+  static portMUX_TYPE lock_;
+#endif
+};
+
+#if ESPGAMEAPI_TRACE_LEN
+  #define GAME_TRACE(...)  TraceLog::record(__VA_ARGS__)
+#else
+  #define GAME_TRACE(...)  do{}while(0)
+#endif
@@ -1,8 +1,41 @@
 #include "AsyncRequest.hpp"
 
 // Static storage definitions for new AsyncRequest implementation
-QueueHandle_t AsyncRequest::queue_ = NULL;
+AsyncRequest::Request **AsyncRequest::slots_ = NULL;
+uint8_t AsyncRequest::queueLen_ = ASYNCREQUEST_QUEUE_LEN;
+uint8_t AsyncRequest::queued_ = 0;
+uint32_t AsyncRequest::seq_ = 0;
+uint32_t AsyncRequest::nextId_ = 0;
+portMUX_TYPE AsyncRequest::lock_ = portMUX_INITIALIZER_UNLOCKED;
+AsyncRequest::WorkerSlot AsyncRequest::workers_[ASYNCREQUEST_MAX_WORKERS];
+uint8_t AsyncRequest::workerCount_ = 0;
+uint32_t AsyncRequest::batchDepth_ = 0;
+uint32_t AsyncRequest::heldWakeups_ = 0;
+uint32_t AsyncRequest::heldOrigin_ = 0;
 bool AsyncRequest::started_ = false;
+uint32_t AsyncRequest::linkEpoch_ = 0;
+bool AsyncRequest::deferCallbacks_ = false;
+QueueHandle_t AsyncRequest::done_ = NULL;
 uint8_t AsyncRequest::maxWorkers_ = 1;
+uint32_t AsyncRequest::workerStack_ = ASYNCREQUEST_WORKER_STACK;
+UBaseType_t AsyncRequest::workerPriority_ = ASYNCREQUEST_WORKER_PRIORITY;
+BaseType_t AsyncRequest::workerCore_ = ASYNCREQUEST_WORKER_CORE;
 bool AsyncRequest::insecureTLS_ = true;
 volatile uint32_t AsyncRequest::activeWorkers_ = 0;
+AsyncRequest::Request *AsyncRequest::pool_ = NULL;
+uint16_t AsyncRequest::poolLen_ = 0;
+AsyncRequest::Request *AsyncRequest::freeList_ = NULL;
+uint32_t AsyncRequest::allocs_ = 0;
+uint32_t AsyncRequest::poolMisses_ = 0;
+#if ASYNCREQUEST_DNS_CACHE
+AsyncRequest::DnsEntry AsyncRequest::dns_[ASYNCREQUEST_DNS_CACHE];
+#endif
+#if ASYNCREQUEST_METRICS
+AsyncRequest::Metrics AsyncRequest::metrics_;
+portMUX_TYPE AsyncRequest::metricsLock_ = portMUX_INITIALIZER_UNLOCKED;
+#endif
+#if ESPGAMEAPI_TRACE_LEN
+TraceLog::Event TraceLog::ring_[ESPGAMEAPI_TRACE_LEN];
+uint32_t TraceLog::next_ = 0;
+portMUX_TYPE TraceLog::lock_ = portMUX_INITIALIZER_UNLOCKED;
+#endif
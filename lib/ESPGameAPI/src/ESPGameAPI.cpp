@@ -1,6 +1,8 @@
 #include "ESPGameAPI.h"
 #include "AsyncRequest.hpp"
 #include <ArduinoJson.h>
+#include <memory>
+#include <new>
 
 // NOTE: Previously a custom embedded certificate bundle was used via
 // arduino_esp_crt_bundle_set(x509_crt_bundle_start). That bundle was in an
@@ -19,29 +21,385 @@
 #endif
 // ─────────────────────────────────────────────
 
+// Path per endpoint id (also the metrics slot of its requests)
+const char* const ESPGameAPI::endpointPaths[EP_COUNT] = {
+    "", "/coreapi/post_vals", "/coreapi/prod_connected", "/coreapi/cons_connected",
+    "/coreapi/post_vals", "/coreapi/login", "/coreapi/register", "/coreapi/poll_binary",
+    "/coreapi/poll_binary?wait=" ESPGAMEAPI_STR(ESPGAMEAPI_LONGPOLL_WAIT_S),
+    "/coreapi/tick_binary", "/coreapi/prod_vals", "/coreapi/cons_vals",
+    "/coreapi/metrics_binary", "/coreapi/post_vals_batch"
+};
+
+const char* ESPGameAPI::metricsSlotName(uint8_t slot) {
+    return slot && slot < EP_COUNT ? endpointPaths[slot] : "(other)";
+}
+
+AsyncRequest::Headers ESPGameAPI::condHeaders;
+std::vector<uint8_t>  ESPGameAPI::txBuf;
+std::vector<ConnectedPowerPlant> ESPGameAPI::plantsScratch;
+std::vector<ConnectedConsumer>   ESPGameAPI::consumersScratch;
+
+// Endpoint URLs (and their origin key) are formatted once per server, not per
+// request or board
+ESPGameAPI::Shared::Shared(const String& baseUrl) : publishMutex(xSemaphoreCreateMutex()) {
+    for (uint8_t i = 1; i < EP_COUNT; i++) {
+        urls[i] = std::string(baseUrl.c_str()) + endpointPaths[i];
+    }
+    originHash = AsyncRequest::originHash(urls[EP_POLL]);
+}
+
+ESPGameAPI::Shared::~Shared() {
+    for (PollDecoder* d : decoders) delete d;
+    vSemaphoreDelete(publishMutex);
+}
+
+PollDecoder* ESPGameAPI::Shared::claimDecoder() {
+    int spare = -1;
+    portENTER_CRITICAL(&lock);
+    for (int i = 0; i < ESPGAMEAPI_POLL_DECODERS; i++) {
+        if (decoders[i] && !busy[i]) { busy[i] = true; portEXIT_CRITICAL(&lock); return decoders[i]; }
+        if (!decoders[i] && spare < 0) spare = i;
+    }
+    portEXIT_CRITICAL(&lock);
+    if (spare < 0) return NULL;
+    // Only the loop task adds decoders, so the empty slot is still empty
+    PollDecoder* d = new PollDecoder();
+    portENTER_CRITICAL(&lock);
+    decoders[spare] = d;
+    busy[spare] = true;
+    portEXIT_CRITICAL(&lock);
+    return d;
+}
+
+void ESPGameAPI::Shared::releaseDecoder(PollDecoder* d) {
+    portENTER_CRITICAL(&lock);
+    for (int i = 0; i < ESPGAMEAPI_POLL_DECODERS; i++) {
+        if (decoders[i] == d) busy[i] = false;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
 // constructor ------------------------------------------------------------------
 ESPGameAPI::ESPGameAPI(const String& url, const String& name, BoardType type,
                        unsigned long upd, unsigned long poll)
+    : ESPGameAPI(url, name, type, upd, poll, new Shared(url)) {
+    ownsShared = true;
+}
+
+ESPGameAPI::ESPGameAPI(ESPGameAPI& server, const String& name, BoardType type,
+                       unsigned long upd, unsigned long poll)
+    : ESPGameAPI(server.baseUrl, name, type, upd, poll, server.shared) {}
+
+ESPGameAPI::ESPGameAPI(const String& url, const String& name, BoardType type,
+                       unsigned long upd, unsigned long poll, Shared* state)
     : baseUrl(url), boardName(name), boardType(type),
       isLoggedIn(false), isRegistered(false),
+      connState(CONN_IDLE), autoConnect(false), authInFlight(false), linkWarm(false), connectRetryAt(0),
+      tokenReady(false), sessionEvents(0), pendingProtocol(PROTOCOL_VERSION),
       lastUpdateTime(0), lastPollTime(0),
       updateInterval(upd), pollInterval(poll),
-      gameActive(false),
+      updateGap(upd), pollGap(poll),
+      adaptiveIntervals(false), holdOff(false), holdOffUntil(0), wasGameActive(false),
       coeffsUpdated(false),
-      requestPollInFlight(false), requestPostInFlight(false), requestRangesInFlight(false) {}
+      requestPollInFlight(false), requestPostInFlight(false), requestRangesInFlight(false),
+      combinedExchange(false), combinedSupported(true),
+      plantsSeq(0), consumersSeq(0), plantsAcked(0), consumersAcked(0),
+      plantsPending(false), consumersPending(false),
+      plantsReported(false), consumersReported(false), plantsChanged(false),
+      lastPlantsAckTime(0), lastConsumersAckTime(0),
+      reportRefreshInterval(ESPGAMEAPI_REPORT_REFRESH_MS),
+      reportDeadband(0.0f),
+      pollETag(),
+      pushMode(false), pollImmediately(false), pipelining(false),
+      lastWindow(), samplingInterval(0), lastSampleTime(0), samplerTask(NULL),
+      postedNext(0), backlogInFlight(false), backlogEnd(0),
+      compactProtocol(false), serverProtocol(PROTOCOL_VERSION), powerBase(), powerSeq(0), postedSeqs(),
+      powerAckedTags(0), powerRejected(false), indexReplyLen(0),
+      shared(state), ownsShared(false) {
+    rebuildAuthHeaders();
+}
+
+// Requests still in flight keep `this`; only destroy idle instances, and
+// virtual boards before the board they share state with
+ESPGameAPI::~ESPGameAPI() {
+    setSamplingInterval(0);
+    if (ownsShared) delete shared;
+}
+
+void ESPGameAPI::rebuildAuthHeaders() {
+    std::string bearer = "Bearer " + std::string(token.c_str());
+    authHeaders   = { { "Authorization", bearer } };
+    binaryHeaders = { { "Authorization", bearer }, { "Content-Type", "application/octet-stream" } };
+}
+
+// ───────────────────────────────────────────── payload builders
+// LEB128: 7 bits per byte, low group first, high bit = more follows
+void ESPGameAPI::appendVarint(std::vector<uint8_t>& data, uint32_t v) {
+    while (v >= 0x80) {
+        data.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(v));
+}
 
-// ───────────────────────────────────────────── byte‑order helpers (unchanged)
-uint32_t ESPGameAPI::hostToNetworkLong(uint32_t v) {
-    return ((v & 0xFF000000) >> 24) | ((v & 0x00FF0000) >> 8) |
-           ((v & 0x0000FF00) << 8)  | ((v & 0x000000FF) << 24);
+// Small magnitudes of either sign stay small: 0, -1, 1, -2 -> 0, 1, 2, 3
+void ESPGameAPI::appendZigZag(std::vector<uint8_t>& data, int32_t v) {
+    appendVarint(data, (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31));
 }
-uint64_t ESPGameAPI::hostToNetworkLongLong(uint64_t v) {
-    return ((uint64_t)hostToNetworkLong((uint32_t)v) << 32) |
-            hostToNetworkLong((uint32_t)(v >> 32));
+
+// Legacy per-endpoint frames have no version byte; compact ones always do
+void ESPGameAPI::startFrame(std::vector<uint8_t>& data) {
+    data.clear();
+    if (useCompact()) data.push_back(PROTOCOL_VERSION_COMPACT);
+}
+
+// Compact: [seq | base distance << 4 | KEY] then zig-zag deltas (absolute
+// values in key frames). The server keeps its last 8 acknowledged samples
+// by seq and answers 409 when a delta's base is unknown.
+void ESPGameAPI::appendPowerData(std::vector<uint8_t>& data, uint8_t tag) {
+    const PowerSampleRing::Sample& smp = postedSamples[tag];
+    if (!useCompact()) {
+        Wire::append(data, PowerDataRequest{ smp.production, smp.consumption });
+        return;
+    }
+    uint8_t seq = powerSeq;
+    powerSeq = (powerSeq + 1) & 0x0F;
+    postedSeqs[tag] = seq;
+    uint8_t distance = (seq - powerBase.seq) & 0x0F;
+    if (powerBase.valid && distance >= 1 && distance <= 7) {
+        data.push_back(static_cast<uint8_t>(distance << 4 | seq));
+        appendZigZag(data, smp.production  - powerBase.production);
+        appendZigZag(data, smp.consumption - powerBase.consumption);
+    } else {
+        data.push_back(static_cast<uint8_t>(0x80 | seq));
+        appendZigZag(data, smp.production);
+        appendZigZag(data, smp.consumption);
+    }
+}
+
+// Acknowledgements may arrive out of order; the base only moves forward
+void ESPGameAPI::ackPowerFrame(uint8_t tag) {
+    uint8_t seq = postedSeqs[tag];
+    if (seq == LEGACY_FRAME) return;
+    uint8_t ahead = (seq - powerBase.seq) & 0x0F;
+    if (powerBase.valid && (ahead == 0 || ahead > 7)) return;
+    powerBase.production  = postedSamples[tag].production;
+    powerBase.consumption = postedSamples[tag].consumption;
+    powerBase.seq   = seq;
+    powerBase.valid = true;
+}
+
+// New session or toggled protocol: next power frame is a key frame and
+// buildings are sent in full again
+void ESPGameAPI::resetCompactState() {
+    powerBase.valid = false;
+    powerSeq = 0;
+    buildingIndex.clear();
+    __atomic_store_n(&powerAckedTags, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&powerRejected, false, __ATOMIC_RELEASE);
+    portENTER_CRITICAL(&compactLock);
+    indexReplyLen = 0;
+    portEXIT_CRITICAL(&compactLock);
+}
+
+// Worker task: keeps the reply for applyCompactAcks(); a newer one replaces
+// it, the buildings it missed are sent in full until the next reply
+void ESPGameAPI::recordIndexReply(const uint8_t* body, size_t len) {
+    if (len > sizeof(indexReply)) len = sizeof(indexReply);   // parser stops at the cut
+    portENTER_CRITICAL(&compactLock);
+    memcpy(indexReply, body, len);
+    indexReplyLen = len;
+    portEXIT_CRITICAL(&compactLock);
+}
+
+// Loop task: acknowledgements and rejections recorded since the last update()
+void ESPGameAPI::applyCompactAcks() {
+    uint8_t acked = __atomic_exchange_n(&powerAckedTags, 0, __ATOMIC_ACQUIRE);
+    for (uint8_t tag = 0; acked; tag++, acked >>= 1) {
+        if (acked & 1) ackPowerFrame(tag);
+    }
+    if (__atomic_exchange_n(&powerRejected, false, __ATOMIC_ACQUIRE)) powerBase.valid = false;
+    
+    static uint8_t reply[ESPGAMEAPI_INDEX_REPLY_LEN];   // loop task only
+    portENTER_CRITICAL(&compactLock);
+    size_t len = indexReplyLen;
+    memcpy(reply, indexReply, len);
+    indexReplyLen = 0;
+    portEXIT_CRITICAL(&compactLock);
+    if (len) storeBuildingIndexes(reply, len);
+}
+
+void ESPGameAPI::appendPowerPlants(std::vector<uint8_t>& data, ItemView<ConnectedPowerPlant> plants) {
+    if (useCompact()) {
+        appendVarint(data, plants.size());
+        for (const auto& plant : plants) {
+            appendVarint(data, plant.plant_id);
+            appendZigZag(data, static_cast<int32_t>(plant.set_power * 1000));
+        }
+        return;
+    }
+    data.push_back(static_cast<uint8_t>(plants.size()));
+    for (const auto& plant : plants) {
+        Wire::append(data, PowerPlantEntry{ plant.plant_id, static_cast<int32_t>(plant.set_power * 1000) });
+    }
+}
+
+void ESPGameAPI::appendConsumers(std::vector<uint8_t>& data, ItemView<ConnectedConsumer> consumers) {
+    if (useCompact()) {
+        appendVarint(data, consumers.size());
+        for (const auto& consumer : consumers) appendVarint(data, consumer.consumer_id);
+        return;
+    }
+    data.push_back(static_cast<uint8_t>(consumers.size()));
+    for (const auto& consumer : consumers) {
+        Wire::append(data, ConsumerEntry{ consumer.consumer_id });
+    }
+}
+
+void ConnectedBuilding::setUid(const char* s, size_t len) {
+    if (len > ESPGAMEAPI_UID_LEN) len = ESPGAMEAPI_UID_LEN;
+    memcpy(uid, s, len);
+    uid[len] = '\0';
+}
+
+void ESPGameAPI::appendBuildings(std::vector<uint8_t>& data, ItemView<ConnectedBuilding> buildings) {
+    data.push_back(static_cast<uint8_t>(buildings.size()));
+    for (const auto& building : buildings) {
+        // Compact: varint (index + 1) once the server assigned one, else 0
+        // followed by the full legacy entry
+        if (useCompact()) {
+            uint32_t ref = 0;
+            for (const auto& known : buildingIndex) {
+                if (strcmp(known.uid, building.uid) == 0) { ref = known.index + 1u; break; }
+            }
+            appendVarint(data, ref);
+            if (ref) continue;
+        }
+        size_t uid_len = building.uidLength();
+        data.push_back(static_cast<uint8_t>(uid_len));
+        data.insert(data.end(), building.uid, building.uid + uid_len);
+        data.push_back(building.building_type);
+    }
+}
+
+// Compact post_vals reply: [count u8] count × [index u8][uid_len u8][uid]
+void ESPGameAPI::storeBuildingIndexes(const uint8_t* p, size_t len) {
+    Wire::Reader in(p, len);
+    uint8_t count = 0;
+    in.read(count);
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t index, uidLen;
+        if (!in.read(index) || !in.read(uidLen) || in.remaining() < uidLen) break;
+        IndexedBuilding entry;
+        size_t n = uidLen > ESPGAMEAPI_UID_LEN ? ESPGAMEAPI_UID_LEN : uidLen;
+        memcpy(entry.uid, in.pos(), n);
+        entry.uid[n] = '\0';
+        entry.index = index;
+        in.skip(uidLen);
+        
+        bool known = false;
+        for (auto& existing : buildingIndex) {
+            if (strcmp(existing.uid, entry.uid) == 0) { existing.index = index; known = true; break; }
+        }
+        if (!known) buildingIndex.push_back(entry);   // full: the rest stay sent in full
+    }
+}
+
+// ───────────────────────────────────────────── device report dirty tracking
+ItemView<ConnectedPowerPlant> ESPGameAPI::currentPlants() {
+    if (powerPlantsSource) return powerPlantsSource();
+    if (!powerPlantsCallback) return ItemView<ConnectedPowerPlant>();
+    plantsScratch = powerPlantsCallback();
+    return plantsScratch;
+}
+
+ItemView<ConnectedConsumer> ESPGameAPI::currentConsumers() {
+    if (consumersSource) return consumersSource();
+    if (!consumersCallback) return ItemView<ConnectedConsumer>();
+    consumersScratch = consumersCallback();
+    return consumersScratch;
+}
+
+static uint8_t nextReportSeq(uint8_t& seq) {
+    seq = seq >= 0xFE ? 1 : seq + 1;   // never NO_SAMPLE
+    return seq;
+}
+
+uint8_t ESPGameAPI::stagePlantsReport(ItemView<ConnectedPowerPlant> plants) {
+    sentPlants.assign(plants.begin(), plants.end());
+    plantsPending = true;
+    return nextReportSeq(plantsSeq);
+}
+
+uint8_t ESPGameAPI::stageConsumersReport(ItemView<ConnectedConsumer> consumers) {
+    sentConsumers.assign(consumers.begin(), consumers.end());
+    consumersPending = true;
+    return nextReportSeq(consumersSeq);
+}
+
+// Only an acknowledgement of the latest sent list counts; an older one
+// arriving late leaves the report due, which errs on re-sending
+void ESPGameAPI::applyReportAcks(unsigned long now) {
+    if (plantsPending && plantsAcked == plantsSeq) {
+        lastReportedPlants.swap(sentPlants);
+        lastPlantsAckTime = now;
+        plantsPending = false;
+        plantsReported = true;
+    }
+    if (consumersPending && consumersAcked == consumersSeq) {
+        lastReportedConsumers.swap(sentConsumers);
+        lastConsumersAckTime = now;
+        consumersPending = false;
+        consumersReported = true;
+    }
+}
+
+bool ESPGameAPI::plantsReportDue(ItemView<ConnectedPowerPlant> plants, unsigned long now) {
+    applyReportAcks(now);
+    if (!plantsReported || reportRefreshInterval == 0) return true;
+    if (now - lastPlantsAckTime >= reportRefreshInterval) return true;
+    if (plants.size() != lastReportedPlants.size()) return true;
+    for (size_t i = 0; i < plants.size(); i++) {
+        if (plants[i].plant_id != lastReportedPlants[i].plant_id) return true;
+        if (fabsf(plants[i].set_power - lastReportedPlants[i].set_power) > reportDeadband) return true;
+    }
+    return false;
+}
+
+bool ESPGameAPI::consumersReportDue(ItemView<ConnectedConsumer> consumers, unsigned long now) {
+    applyReportAcks(now);
+    if (!consumersReported || reportRefreshInterval == 0) return true;
+    if (now - lastConsumersAckTime >= reportRefreshInterval) return true;
+    if (consumers.size() != lastReportedConsumers.size()) return true;
+    for (size_t i = 0; i < consumers.size(); i++) {
+        if (consumers[i].consumer_id != lastReportedConsumers[i].consumer_id) return true;
+    }
+    return false;
+}
+
+// The completion carries only the sequence (see onBinaryDone()), so no list
+// is copied into the callback
+void ESPGameAPI::reportPlantsIfChanged(unsigned long now) {
+    if (!hasPlants() || !isRegistered) return;
+    ItemView<ConnectedPowerPlant> plants = currentPlants();
+    if (!plantsReportDue(plants, now)) return;
+    
+    uint8_t seq = stagePlantsReport(plants);
+    startFrame(txBuf);
+    appendPowerPlants(txBuf, plants);
+    sendBinary(EP_PROD_CONNECTED, AsyncRequest::Priority::REPORT, EP_PROD_CONNECTED, nullptr, seq);
+}
+
+void ESPGameAPI::reportConsumersIfChanged(unsigned long now) {
+    if (!hasConsumers() || !isRegistered) return;
+    ItemView<ConnectedConsumer> consumers = currentConsumers();
+    if (!consumersReportDue(consumers, now)) return;
+    
+    uint8_t seq = stageConsumersReport(consumers);
+    startFrame(txBuf);
+    appendConsumers(txBuf, consumers);
+    sendBinary(EP_CONS_CONNECTED, AsyncRequest::Priority::REPORT, EP_CONS_CONNECTED, nullptr, seq);
 }
-uint32_t ESPGameAPI::networkToHostLong    (uint32_t v){ return hostToNetworkLong(v); }
-uint64_t ESPGameAPI::networkToHostLongLong(uint64_t v){ return hostToNetworkLongLong(v);}
-uint16_t ESPGameAPI::networkToHostShort   (uint16_t v){ return (v>>8)|(v<<8); }
 
 // ───────────────────────────────────────────── boardType -> string
 String ESPGameAPI::boardTypeToString(BoardType t) const {
@@ -55,22 +413,20 @@ String ESPGameAPI::boardTypeToString(BoardType t) const {
 void ESPGameAPI::initCertificateBundle() {
     // Initialize AsyncRequest backend with configurable worker count
     // Default: 1 worker for thread safety, can be increased if needed
-    if (!AsyncRequest::begin(3, 8, 8192, 1, 1)) {
-        Serial.println("⚠️ Failed to initialize AsyncRequest workers");
+    if (!AsyncRequest::begin(3, 0, 0, ASYNCREQUEST_WORKER_PRIORITY, ASYNCREQUEST_WORKER_CORE)) {
+        GAME_LOG("⚠️ Failed to initialize AsyncRequest workers\n");
     } else {
-        Serial.println("🔒 AsyncRequest initialized with HTTPClient backend");
+        GAME_LOG("🔒 AsyncRequest initialized with HTTPClient backend\n");
     }
 }
 
-// ───────────────────────────────────────────── login / register (unchanged)
-//  … full original blocking implementations kept – omitted here for brevity …
+// ───────────────────────────────────────────── login / register
+// Both requests complete in onLoginDone() / onRegisterDone(), which capture
+// only `this`, so a blocking caller that times out leaves nothing dangling.
 #include <ArduinoJson.h>      // needed by original code
 
-bool ESPGameAPI::login(const String& user, const String& pass){ 
-    username = user;
-    password = pass;
-    
-    Serial.println("🔐 Attempting login for: " + username);
+void ESPGameAPI::startLogin() {
+    GAME_LOG("🔐 Attempting login for: %s\n", username.c_str());
     
     JsonDocument doc;
     doc["username"] = username;
@@ -78,297 +434,779 @@ bool ESPGameAPI::login(const String& user, const String& pass){
     
     String jsonString;
     serializeJson(doc, jsonString);
-    Serial.println("📤 Sending JSON: " + jsonString);
-    
-    // Use a blocking approach with AsyncRequest
-    volatile bool requestComplete = false;
-    volatile bool loginSuccess = false;
     
+    authInFlight = true;
     AsyncRequest::fetch(
         AsyncRequest::Method::POST,
-        std::string((baseUrl + "/coreapi/login").c_str()),
-        std::string(jsonString.c_str()),
+        shared->urls[EP_LOGIN],
+        reinterpret_cast<const uint8_t*>(jsonString.c_str()), jsonString.length(),
         { { "Content-Type", "application/json" } },
-        [&](esp_err_t err, int status, std::string body) {
-            Serial.printf("📥 Login HTTP %d\n", status);
-            
-            if (err != ESP_OK) {
-                Serial.println("❌ Login request failed: " + String(esp_err_to_name(err)));
-                requestComplete = true;
+        requestOptions(AsyncRequest::Priority::AUTH, EP_LOGIN),
+        [this](esp_err_t err, int status, const uint8_t* body, size_t len) { onLoginDone(err, status, body, len); });
+}
+
+// Worker task: only hands the token over, applyLogin() installs it
+void ESPGameAPI::onLoginDone(esp_err_t err, int status, const uint8_t* body, size_t len) {
+    GAME_LOG("📥 Login HTTP %d\n", status);
+    
+    if (err != ESP_OK) {
+        GAME_LOG("❌ Login request failed: %s\n", esp_err_to_name(err));
+    } else if (status == 200) {
+        JsonDocument responseDoc;
+        if (deserializeJson(responseDoc, reinterpret_cast<const char*>(body), len) == DeserializationError::Ok) {
+            if (responseDoc["token"].is<const char*>()) {
+                pendingToken = responseDoc["token"].as<const char*>();
+                __atomic_store_n(&tokenReady, true, __ATOMIC_RELEASE);
+                authInFlight = false;
                 return;
             }
-            
-            if (status == 200) {
-                JsonDocument responseDoc;
-                if (deserializeJson(responseDoc, body) == DeserializationError::Ok) {
-                    if (responseDoc["token"].is<const char*>()) {
-                        token = responseDoc["token"].as<const char*>();
-                        isLoggedIn = true;
-                        loginSuccess = true;
-                        Serial.println("🔐 Successfully logged in");
-                        Serial.println("🎫 Token: " + token.substring(0, 20) + "...");
-                    } else {
-                        Serial.println("❌ Token not found in response");
-                    }
-                } else {
-                    Serial.println("❌ Failed to parse JSON response");
-                }
-            } else if (status == 401) {
-                Serial.println("❌ Invalid credentials (401)");
-            } else if (status == 404) {
-                Serial.println("❌ Login endpoint not found (404) - Check server URL");
-            } else {
-                Serial.println("❌ Login failed with HTTP code: " + String(status));
-            }
-            requestComplete = true;
-        });
+            GAME_LOG("❌ Token not found in response\n");
+        } else {
+            GAME_LOG("❌ Failed to parse JSON response\n");
+        }
+    } else if (status == 401) {
+        GAME_LOG("❌ Invalid credentials (401)\n");
+    } else if (status == 404) {
+        GAME_LOG("❌ Login endpoint not found (404) - Check server URL\n");
+    } else {
+        GAME_LOG("❌ Login failed with HTTP code: %d\n", status);
+    }
+    connectRetryAt = millis() + ESPGAMEAPI_CONNECT_RETRY_MS;
+    authInFlight = false;
+}
+
+// Loop task: requests built from here on carry the new token
+void ESPGameAPI::applyLogin() {
+    if (!__atomic_load_n(&tokenReady, __ATOMIC_ACQUIRE)) return;
+    token = pendingToken;
+    pendingToken = String();
+    __atomic_store_n(&tokenReady, false, __ATOMIC_RELEASE);
+    rebuildAuthHeaders();
+    isLoggedIn = true;
+    GAME_LOG("🔐 Successfully logged in\n");
+    GAME_LOG("🎫 Token: %.20s...\n", token.c_str());
+    setConnectionState(CONN_REGISTER);
+}
+
+void ESPGameAPI::startRegister() {
+    GAME_LOG("📋 Attempting board registration...\n");
+    GAME_LOG("🎫 Using token: %.20s...\n", token.c_str());
+    
+    authInFlight = true;
+    AsyncRequest::fetch(
+        AsyncRequest::Method::POST,
+        shared->urls[EP_REGISTER],
+        NULL, 0,  // no body
+        authHeaders,
+        requestOptions(AsyncRequest::Priority::AUTH, EP_REGISTER),
+        [this](esp_err_t err, int status, const uint8_t* body, size_t len) { onRegisterDone(err, status, body, len); });
+}
+
+// Worker task: only records the outcome, applySession() starts the session
+void ESPGameAPI::onRegisterDone(esp_err_t err, int status, const uint8_t* body, size_t len) {
+    GAME_LOG("📥 Register HTTP %d\n", status);
+    
+    if (err != ESP_OK) {
+        GAME_LOG("❌ Registration request failed: %s\n", esp_err_to_name(err));
+    } else if (status == 401) {
+        onAuthExpired();
+        authInFlight = false;
+        return;
+    } else if (status == 200 && len >= 2) {
+        uint8_t successFlag = body[0];
+        uint8_t messageLength = body[1];
+        
+        GAME_LOG("🚩 Success flag: %u\n", successFlag);
+        GAME_LOG("📏 Message length: %u\n", messageLength);
+        
+        if (successFlag == 0x01) {
+            // Servers that speak the compact protocol append their version
+            size_t versionAt = 2 + messageLength;
+            pendingProtocol = len > versionAt ? body[versionAt] : PROTOCOL_VERSION;
+            postSession(SESSION_REGISTERED);
+            authInFlight = false;
+            return;
+        }
+        // Print error message if available
+        if (messageLength > 0 && len >= (size_t)(2 + messageLength)) {
+            GAME_LOG("❌ Registration failed: %.*s\n", messageLength < 64 ? (int)messageLength : 64, reinterpret_cast<const char*>(body) + 2);
+        } else {
+            GAME_LOG("❌ Registration failed: unknown error\n");
+        }
+    } else {
+        GAME_LOG("❌ Registration response invalid or too short\n");
+    }
+    connectRetryAt = millis() + ESPGAMEAPI_CONNECT_RETRY_MS;
+    authInFlight = false;
+}
+
+// Worker task: token rejected, applySession() drops the session
+void ESPGameAPI::onAuthExpired() {
+    postSession(SESSION_EXPIRED);
+}
+
+// Loop task: session changes recorded since the last update()
+void ESPGameAPI::applySession() {
+    uint8_t events = __atomic_exchange_n(&sessionEvents, 0, __ATOMIC_ACQUIRE);
+    if (events & SESSION_REGISTERED) {
+        isRegistered = true;
+        serverProtocol = pendingProtocol;
+        resetCompactState();
+        forceDeviceReport();  // new session: server has no device lists yet
+        clearPollETag();
+        // First poll on the next update() (spread a little when adaptive)
+        lastPollTime = millis();
+        pollGap = adaptiveIntervals ? AdaptiveInterval::jitter(pollInterval) / 4 : 0;
+        GAME_LOG("📋 Successfully registered board: %s\n", boardName.c_str());
+        setConnectionState(CONN_FIRST_POLL);
+    }
+    if (events & SESSION_EXPIRED) {
+        expireSession();
+    } else if ((events & SESSION_ANSWERED) && connState == CONN_FIRST_POLL) {
+        setConnectionState(CONN_ONLINE);
+    }
+}
+
+// Drop the session and log in again from update()
+void ESPGameAPI::expireSession() {
+    if (!isLoggedIn) return;
+    GAME_TRACE(TR_AUTH_EXPIRED);
+    GAME_LOG("🔐 Session expired (401) - logging in again\n");
+    isLoggedIn = false;
+    isRegistered = false;
+    if (username.length()) autoConnect = true;
+    connectRetryAt = millis();
+    setConnectionState(CONN_LOGIN);
+}
+
+void ESPGameAPI::setConnectionState(ConnectionState state) {
+    if (state == connState) return;
+    connState = state;
+    GAME_TRACE(TR_CONN_STATE, state);
+    GAME_LOG("🔗 Connection state: %s\n", connectionStateName(state));
+    if (connectionStateCallback) connectionStateCallback(state);
+}
+
+const char* ESPGameAPI::connectionStateName(ConnectionState state) {
+    switch (state) {
+        case CONN_IDLE:       return "idle";
+        case CONN_WAIT_WIFI:  return "wait_wifi";
+        case CONN_LOGIN:      return "login";
+        case CONN_REGISTER:   return "register";
+        case CONN_FIRST_POLL: return "first_poll";
+        case CONN_ONLINE:     return "online";
+        default:              return "unknown";
+    }
+}
+
+void ESPGameAPI::connect(const String& user, const String& pass) {
+    username = user;
+    password = pass;
+    isLoggedIn = false;
+    isRegistered = false;
+    autoConnect = true;
+    connectRetryAt = millis();
+    setConnectionState(CONN_WAIT_WIFI);
+}
+
+// One step of WiFi → login → register → first poll, driven from update()
+void ESPGameAPI::advanceConnection(unsigned long now) {
+    if (!autoConnect) return;
     
-    // Wait for completion (blocking)
+    if (WiFi.status() != WL_CONNECTED) {
+        // The session survives a WiFi drop; only the link is waited for. Its
+        // sockets do not (WiFiLink closes them from the event already).
+        if (connState != CONN_WAIT_WIFI) {
+            if (ownsShared) AsyncRequest::dropConnections();
+            setConnectionState(CONN_WAIT_WIFI);
+        }
+        linkWarm = false;
+        return;
+    }
+    if (authInFlight || (long)(now - connectRetryAt) < 0) return;
+    
+    switch (connState) {
+        case CONN_IDLE:
+        case CONN_WAIT_WIFI:
+            // Link is up: open the server connection (DNS, TCP, TLS) before
+            // anything else, so login or the next poll finds it warm. Waiting
+            // for it matters: a request queued meanwhile would go to another,
+            // cold worker. Virtual boards use the owner's connection.
+            if (ownsShared && !linkWarm) {
+                linkWarm = true;
+                authInFlight = true;
+                AsyncRequest::prewarm(shared->urls[EP_POLL], EP_NONE,
+                    [this](esp_err_t, int, std::string) { authInFlight = false; });
+                break;
+            }
+            setConnectionState(!isLoggedIn ? CONN_LOGIN : !isRegistered ? CONN_REGISTER : CONN_ONLINE);
+            break;
+        case CONN_LOGIN:    startLogin();    break;
+        case CONN_REGISTER: startRegister(); break;
+        default: break;   // the regular poll schedule completes CONN_FIRST_POLL
+    }
+}
+
+// Worker task: the first successful poll (or tick) after registering brings
+// the board online (in applySession())
+void ESPGameAPI::onPollAnswered(int status) {
+    if (status == 401) onAuthExpired();
+    else if (status == 200 || status == 304) postSession(SESSION_ANSWERED);
+}
+
+bool ESPGameAPI::waitForAuth() {
     unsigned long startTime = millis();
-    while (!requestComplete && (millis() - startTime) < 10000) {
+    while (authInFlight && (millis() - startTime) < ESPGAMEAPI_AUTH_TIMEOUT_MS) {
+        AsyncRequest::poll();   // deferred callbacks complete here
         delay(10);
     }
+    return !authInFlight;
+}
+
+bool ESPGameAPI::login(const String& user, const String& pass){ 
+    username = user;
+    password = pass;
     
-    if (!requestComplete) {
-        Serial.println("❌ Login request timeout");
+    if (authInFlight && !waitForAuth()) {
+        GAME_LOG("❌ Login request timeout\n");
         return false;
     }
-    
-    return loginSuccess;
+    startLogin();
+    if (!waitForAuth()) {
+        GAME_LOG("❌ Login request timeout\n");
+        return false;
+    }
+    applyLogin();
+    return isLoggedIn;
 }
+
 bool ESPGameAPI::registerBoard(){ 
     if (!isLoggedIn) {
-        Serial.println("❌ Cannot register: not logged in");
+        GAME_LOG("❌ Cannot register: not logged in\n");
         return false;
     }
     
-    Serial.println("📋 Attempting board registration...");
-    Serial.println("🎫 Using token: " + token.substring(0, 20) + "...");
-    
-    // Use blocking approach with AsyncRequest
-    volatile bool requestComplete = false;
-    volatile bool registerSuccess = false;
-    
-    AsyncRequest::fetch(
-        AsyncRequest::Method::POST,
-        std::string((baseUrl + "/coreapi/register").c_str()),
-        "",  // no body
-        { { "Authorization", "Bearer " + std::string(token.c_str()) } },
-        [&](esp_err_t err, int status, std::string body) {
-            Serial.printf("📥 Register HTTP %d\n", status);
-            
-            if (err != ESP_OK) {
-                Serial.println("❌ Registration request failed: " + String(esp_err_to_name(err)));
-                requestComplete = true;
-                return;
-            }
-            
-            if (status == 200 && body.size() >= 2) {
-                uint8_t successFlag = static_cast<uint8_t>(body[0]);
-                uint8_t messageLength = static_cast<uint8_t>(body[1]);
-                
-                Serial.println("🚩 Success flag: " + String(successFlag));
-                Serial.println("📏 Message length: " + String(messageLength));
-                
-                if (successFlag == 0x01) {
-                    isRegistered = true;
-                    registerSuccess = true;
-                    Serial.println("📋 Successfully registered board: " + boardName);
-                } else {
-                    // Print error message if available
-                    if (messageLength > 0 && body.size() >= (2 + messageLength)) {
-                        String errorMsg = "";
-                        for (int i = 0; i < messageLength && i < 64; i++) {
-                            errorMsg += static_cast<char>(body[2 + i]);
-                        }
-                        Serial.println("❌ Registration failed: " + errorMsg);
-                    } else {
-                        Serial.println("❌ Registration failed: unknown error");
-                    }
-                }
-            } else {
-                Serial.println("❌ Registration response invalid or too short");
-            }
-            requestComplete = true;
-        });
-    
-    // Wait for completion (blocking)
-    unsigned long startTime = millis();
-    while (!requestComplete && (millis() - startTime) < 10000) {
-        delay(10);
+    if (authInFlight && !waitForAuth()) {
+        GAME_LOG("❌ Registration request timeout\n");
+        return false;
     }
-    
-    if (!requestComplete) {
-        Serial.println("❌ Registration request timeout");
+    startRegister();
+    if (!waitForAuth()) {
+        GAME_LOG("❌ Registration request timeout\n");
         return false;
     }
-    
-    return registerSuccess;
+    applySession();
+    return isRegistered;
 }
 
 // ───────────────────────────────────────────── Response parsing helpers
-void ESPGameAPI::parsePollResponse(const uint8_t* data, size_t len) {
-    if (len == 0) {
-        // Game paused
-        gameActive = false;
-        productionCoefficients.clear();
-        consumptionCoefficients.clear();
-        Serial.println("🎮 Game paused - coefficients cleared");
-        return;
+void PollDecoder::begin(int) {
+    state = S_PROD_COUNT;
+    res = PENDING;
+    err = "";
+    total = 0;
+    production.clear();
+    consumption.clear();
+    buildings.clear();
+    dropped = 0;
+}
+
+static_assert(Wire::Layout<ConsumptionEntry>::size == Wire::Layout<ProductionEntry>::size, "one entry buffer");
+
+bool PollDecoder::write(const uint8_t* data, size_t len) {
+    total += len;
+    for (size_t i = 0; i < len && state != S_DONE && state != S_ERROR; i++) {
+        uint8_t b = data[i];
+        switch (state) {
+            case S_PROD_COUNT:
+                remaining = b; entryPos = 0;
+                state = remaining ? S_PROD_ENTRY : S_CONS_COUNT;
+                break;
+            case S_PROD_ENTRY:
+                entry[entryPos++] = b;
+                if (entryPos == sizeof(entry)) {
+                    // Signed: negative values are valid (e.g. battery charging)
+                    ProductionEntry e;
+                    Wire::decode(e, entry);
+                    ProductionCoefficient c;
+                    c.source_id = e.source_id;
+                    c.coefficient = static_cast<float>(e.coefficient) / 1000.0f;
+                    if (!production.push_back(c)) dropped++;
+                    entryPos = 0;
+                    if (--remaining == 0) state = S_CONS_COUNT;
+                }
+                break;
+            case S_CONS_COUNT:
+                remaining = b; entryPos = 0;
+                state = remaining ? S_CONS_ENTRY : S_BLD_COUNT;
+                break;
+            case S_CONS_ENTRY:
+                entry[entryPos++] = b;
+                if (entryPos == sizeof(entry)) {
+                    ConsumptionEntry e;
+                    Wire::decode(e, entry);
+                    ConsumptionCoefficient c;
+                    c.building_id = e.building_id;
+                    c.consumption = static_cast<float>(e.consumption) / 1000.0f;
+                    if (!consumption.push_back(c)) dropped++;
+                    entryPos = 0;
+                    if (--remaining == 0) state = S_BLD_COUNT;
+                }
+                break;
+            case S_BLD_COUNT:
+                remaining = b;
+                state = remaining ? S_BLD_UIDLEN : S_DONE;
+                break;
+            case S_BLD_UIDLEN:
+                uidLen = b; uidPos = 0;
+                state = uidLen ? S_BLD_UID : S_BLD_TYPE;
+                break;
+            case S_BLD_UID:
+                if (uidPos < ESPGAMEAPI_UID_LEN) uid[uidPos] = static_cast<char>(b);
+                if (++uidPos == uidLen) state = S_BLD_TYPE;
+                break;
+            case S_BLD_TYPE: {
+                ConnectedBuilding building;
+                building.setUid(uid, uidLen);
+                building.building_type = b;
+                if (!buildings.push_back(building)) dropped++;
+                state = --remaining ? S_BLD_UIDLEN : S_DONE;
+                break;
+            }
+            default:
+                break;
+        }
     }
-    
-    if (len < 2) {
-        Serial.println("❌ Poll response too short");
+    return state != S_ERROR;
+}
+
+void PollDecoder::end(bool complete) {
+    if (total == 0 && complete) {
+        res = PAUSED;
         return;
     }
-    
-    size_t offset = 0;
-    uint8_t prodCount = data[offset++];
-    
-    // Check if we have enough data for production coefficients
-    if (len < offset + prodCount * 5 + 1) {
-        Serial.println("❌ Malformed poll response - insufficient data for production coefficients");
+    if (state == S_DONE) {
+        res = COMPLETE;
         return;
     }
-    
-    // Parse production coefficients
-    productionCoefficients.clear();
-    for (uint8_t i = 0; i < prodCount; i++) {
-        ProductionCoefficient coeff;
-        coeff.source_id = data[offset];
-        // Use signed integer parsing to handle negative values (e.g., battery charging)
-        coeff.coefficient = static_cast<float>(static_cast<int32_t>(networkToHostLong(*reinterpret_cast<const uint32_t*>(data + offset + 1)))) / 1000.0f;
-        productionCoefficients.push_back(coeff);
-        offset += 5;
+    if (state != S_ERROR) {
+        switch (state) {
+            case S_PROD_COUNT: case S_PROD_ENTRY: fail("insufficient data for production coefficients"); break;
+            case S_CONS_COUNT: case S_CONS_ENTRY: fail("insufficient data for consumption coefficients"); break;
+            case S_BLD_COUNT:  fail("insufficient data for connected buildings"); break;
+            case S_BLD_UIDLEN: fail("insufficient data for building UID length"); break;
+            default:           fail("insufficient data for building data"); break;
+        }
     }
-    
-    uint8_t consCount = data[offset++];
-    
-    // Check if we have enough data for consumption coefficients
-    if (len < offset + consCount * 5 + 1) {
-        Serial.println("❌ Malformed poll response - insufficient data for consumption coefficients");
-        return;
+    res = MALFORMED;
+}
+
+void ESPGameAPI::parsePollResponse(const uint8_t* data, size_t len) {
+    PollDecoder* decoder = shared->claimDecoder();
+    if (!decoder) return;
+    Shared::Lease lease = { shared, decoder };
+    decoder->decode(data, len);
+    applyPollResult(*decoder);
+}
+
+static bool sameCoefficients(const ProductionList& a, const ProductionList& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].source_id != b[i].source_id || a[i].coefficient != b[i].coefficient) return false;
     }
-    
-    // Parse consumption coefficients
-    consumptionCoefficients.clear();
-    for (uint8_t i = 0; i < consCount; i++) {
-        ConsumptionCoefficient coeff;
-        coeff.building_id = data[offset];
-        // Use signed parsing for consistency, though consumption should be positive
-        coeff.consumption = static_cast<float>(static_cast<int32_t>(networkToHostLong(*reinterpret_cast<const uint32_t*>(data + offset + 1)))) / 1000.0f;
-        consumptionCoefficients.push_back(coeff);
-        offset += 5;
+    return true;
+}
+
+static bool sameCoefficients(const ConsumptionList& a, const ConsumptionList& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].building_id != b[i].building_id || a[i].consumption != b[i].consumption) return false;
+    }
+    return true;
+}
+
+// Publishes a finished decode. Malformed frames leave the previous state.
+bool ESPGameAPI::applyPollResult(PollDecoder& decoder) {
+    if (decoder.result() == PollDecoder::PAUSED) {
+        GameSnapshot& next = beginPublish();
+        bool changed = next.gameActive;
+        next.gameActive = false;
+        next.production.clear();
+        next.consumption.clear();
+        endPublish();
+        GAME_TRACE(TR_PAUSED);
+        GAME_LOG("🎮 Game paused - coefficients cleared\n");
+        return changed;
     }
     
-    // Parse connected buildings
-    uint8_t buildingsCount = data[offset++];
+    if (decoder.result() != PollDecoder::COMPLETE) {
+        GAME_TRACE(TR_MALFORMED);
+        GAME_LOG("❌ Malformed poll response - %s\n", decoder.error());
+        return false;
+    }
     
-    std::vector<ConnectedBuilding> connectedBuildings;
-    for (uint8_t i = 0; i < buildingsCount; i++) {
-        if (offset + 1 > len) {
-            Serial.println("❌ Malformed poll response - insufficient data for building UID length");
-            return;
-        }
-        uint8_t uidLen = data[offset++];
-        
-        if (offset + uidLen + 1 > len) {
-            Serial.println("❌ Malformed poll response - insufficient data for building data");
-            return;
-        }
-        
-        ConnectedBuilding building;
-        String uid = "";
-        for (uint8_t j = 0; j < uidLen; j++) {
-            uid += (char)data[offset++];
-        }
-        building.uid = uid;
-        building.building_type = data[offset++];
-        connectedBuildings.push_back(building);
+    if (decoder.dropped) {
+        GAME_LOG("⚠️ Poll response exceeds list capacity - %u entries dropped\n", decoder.dropped);
     }
     
-    gameActive = true;
-    Serial.println("🎮 Game active - parsed " + String(prodCount) + " production, " + String(consCount) + " consumption coefficients, and " + String(buildingsCount) + " connected buildings");
+    GameSnapshot& next = beginPublish();   // still holds the current state
+    bool changed = !next.gameActive || !sameCoefficients(next.production, decoder.production) ||
+                   !sameCoefficients(next.consumption, decoder.consumption);
+    next.production  = decoder.production;
+    next.consumption = decoder.consumption;
+    next.gameActive = true;
+    endPublish();
+    
+    GAME_TRACE(TR_POLL, next.production.size(), next.consumption.size(), decoder.buildings.size());
+    GAME_LOG("🎮 Game active - parsed %u production, %u consumption coefficients, and %u connected buildings\n",
+                  (unsigned)next.production.size(), (unsigned)next.consumption.size(),
+                  (unsigned)decoder.buildings.size());
     
     // Call buildings callback if set
-    if (buildingsCallback && !connectedBuildings.empty()) {
-        buildingsCallback(connectedBuildings);
+    if (buildingsCallback && !decoder.buildings.empty()) {
+        buildingsCallback(decoder.buildings);
     }
+    return changed;
 }
 
-bool ESPGameAPI::parseProductionRanges(const uint8_t* data, size_t len) {
-    if (len < 1) return false;
-    
-    uint8_t count = data[0];
-    size_t offset = 1;
-    
-    if (len < offset + count * 9) return false;  // 1 byte source_id + 4 bytes min + 4 bytes max
+// ───────────────────────────────────────────── Snapshot publication
+GameSnapshot& ESPGameAPI::beginPublish() {
+    xSemaphoreTake(shared->publishMutex, portMAX_DELAY);
+    uint8_t front = shared->frontSnapshot;
+    GameSnapshot& next = shared->snapshots[front ^ 1];
+    // From here on, readers of the back buffer's previous generation are stale
+    __atomic_store_n(&shared->writeGeneration, shared->snapshots[front].generation + 1, __ATOMIC_RELEASE);
+    const GameSnapshot& cur = shared->snapshots[front];
+    next.gameActive  = cur.gameActive;
+    next.production  = cur.production;   // copies only the used entries
+    next.consumption = cur.consumption;
+    next.ranges      = cur.ranges;
+    return next;
+}
+
+void ESPGameAPI::endPublish() {
+    uint8_t back = shared->frontSnapshot ^ 1;
+    shared->snapshots[back].reindex();
+    shared->snapshots[back].generation = shared->writeGeneration;
+    __atomic_store_n(&shared->frontSnapshot, back, __ATOMIC_RELEASE);
+    xSemaphoreGive(shared->publishMutex);
+}
+
+void GameSnapshot::reindex() {
+    memset(productionIndex,  0, sizeof(productionIndex));
+    memset(consumptionIndex, 0, sizeof(consumptionIndex));
+    memset(rangeIndex,       0, sizeof(rangeIndex));
+    // Counts are u8 on the wire; entries past 255 stay reachable by scan only
+    for (size_t i = production.size(); i-- > 0;) {
+        if (i < 255) productionIndex[production[i].source_id] = i + 1;
+    }
+    for (size_t i = consumption.size(); i-- > 0;) {
+        if (i < 255) consumptionIndex[consumption[i].building_id] = i + 1;
+    }
+    for (size_t i = ranges.size(); i-- > 0;) {
+        if (i < 255) rangeIndex[ranges[i].source_id] = i + 1;
+    }
+}
+
+void ESPGameAPI::readSnapshot(GameSnapshot& out) const {
+    for (;;) {
+        const GameSnapshot& s = snapshot();
+        uint32_t gen = s.generation;
+        out = s;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);   // finish the copy before re-checking
+        if (s.generation == gen && snapshotValid(s)) return;
+    }
+}
+
+// [count] then count × ProductionRangeEntry
+bool ESPGameAPI::rangesFrameValid(const uint8_t* data, size_t len) {
+    return Wire::listFits<ProductionRangeEntry>(data, len);
+}
+
+bool ESPGameAPI::consumptionFrameValid(const uint8_t* data, size_t len) {
+    return Wire::listFits<ConsumptionEntry>(data, len);   // [count] then count × ConsumptionEntry
+}
+
+// Callers check the frame first; entries beyond the list capacity are dropped
+bool ESPGameAPI::parseProductionRanges(const uint8_t* data, size_t len, RangeList& productionRanges) {
+    Wire::Reader in(data, len);
+    uint8_t count;
+    if (!in.list<ProductionRangeEntry>(count)) return false;
     
     productionRanges.clear();
     for (uint8_t i = 0; i < count; i++) {
+        ProductionRangeEntry e = {};
+        in.read(e);
+        // Signed: negative values are valid (e.g., battery charging range)
         ProductionRange range;
-        range.source_id = data[offset];
-        // Use signed integer parsing to handle negative values (e.g., battery charging range)
-        range.min_power = static_cast<float>(static_cast<int32_t>(networkToHostLong(*reinterpret_cast<const uint32_t*>(data + offset + 1)))) / 1000.0f;
-        range.max_power = static_cast<float>(static_cast<int32_t>(networkToHostLong(*reinterpret_cast<const uint32_t*>(data + offset + 5)))) / 1000.0f;
-        productionRanges.push_back(range);
-        offset += 9;
+        range.source_id = e.source_id;
+        range.min_power = static_cast<float>(e.min_power) / 1000.0f;
+        range.max_power = static_cast<float>(e.max_power) / 1000.0f;
+        if (!productionRanges.push_back(range)) {
+            GAME_LOG("⚠️ Production ranges exceed list capacity - %u entries dropped\n", (unsigned)(count - i));
+            break;
+        }
     }
     
     return true;
 }
 
-bool ESPGameAPI::parseConsumptionCoefficients(const uint8_t* data, size_t len) {
-    if (len < 1) return false;
-    
-    uint8_t count = data[0];
-    size_t offset = 1;
-    
-    if (len < offset + count * 5) return false;
+bool ESPGameAPI::parseConsumptionCoefficients(const uint8_t* data, size_t len, ConsumptionList& consumptionCoefficients) {
+    Wire::Reader in(data, len);
+    uint8_t count;
+    if (!in.list<ConsumptionEntry>(count)) return false;
     
     consumptionCoefficients.clear();
     for (uint8_t i = 0; i < count; i++) {
+        ConsumptionEntry e = {};
+        in.read(e);
         ConsumptionCoefficient coeff;
-        coeff.building_id = data[offset];
-        // Consumption should remain positive, but use signed parsing for consistency
-        coeff.consumption = static_cast<float>(static_cast<int32_t>(networkToHostLong(*reinterpret_cast<const uint32_t*>(data + offset + 1)))) / 1000.0f;
-        consumptionCoefficients.push_back(coeff);
-        offset += 5;
+        coeff.building_id = e.building_id;
+        coeff.consumption = static_cast<float>(e.consumption) / 1000.0f;
+        if (!consumptionCoefficients.push_back(coeff)) {
+            GAME_LOG("⚠️ Consumption values exceed list capacity - %u entries dropped\n", (unsigned)(count - i));
+            break;
+        }
     }
     
     return true;
 }
 
+// ───────────────────────────────────────────── Request scheduling
+AsyncRequest::Options ESPGameAPI::requestOptions(AsyncRequest::Priority priority, Endpoint ep, uint8_t coalesceEndpoint) const {
+    AsyncRequest::Options opts;
+    opts.priority = priority;
+    opts.metricsSlot = ep;   // one latency histogram per endpoint
+    opts.originHash = shared->originHash;
+    opts.deadlineMs = ESPGAMEAPI_REQUEST_DEADLINE_MS;
+    // A newer report replaces a still-queued older one; the key is unique per
+    // instance and endpoint (endpoint ids are smaller than the object itself).
+    if (coalesceEndpoint) {
+        opts.coalesceKey = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(this)) + coalesceEndpoint;
+    }
+    return opts;
+}
+
+// Idempotent reads: a copy goes out if the original is slower than the
+// endpoint's p95, the first answer wins
+AsyncRequest::Options ESPGameAPI::hedgedOptions(Endpoint ep) const {
+    AsyncRequest::Options opts = requestOptions(AsyncRequest::Priority::POLL, ep);
+    opts.hedgeAfterMs = AsyncRequest::HEDGE_P95;
+    return opts;
+}
+
+// ───────────────────────────────────────────── Conditional polling
+// Response headers collected for poll_binary / tick_binary
+const char* ESPGameAPI::pollResponseHeaders[] = { "ETag", "Retry-After" };
+
+void ESPGameAPI::storePollETag(const AsyncRequest::Headers& respHeaders) {
+    const std::string* etag = nullptr;
+    for (const auto& h : respHeaders) {
+        if (h.first == "ETag") etag = &h.second;
+    }
+    size_t n = etag && etag->size() <= ESPGAMEAPI_ETAG_LEN ? etag->size() : 0;
+    portENTER_CRITICAL(&etagLock);
+    if (n) memcpy(pollETag, etag->data(), n);
+    pollETag[n] = '\0';
+    portEXIT_CRITICAL(&etagLock);
+}
+
+void ESPGameAPI::clearPollETag() {
+    portENTER_CRITICAL(&etagLock);
+    pollETag[0] = '\0';
+    portEXIT_CRITICAL(&etagLock);
+}
+
+void ESPGameAPI::addPollETag(AsyncRequest::Headers& headers) {
+    char etag[ESPGAMEAPI_ETAG_LEN + 1];
+    portENTER_CRITICAL(&etagLock);
+    memcpy(etag, pollETag, sizeof(etag));
+    portEXIT_CRITICAL(&etagLock);
+    if (etag[0]) headers.push_back({ "If-None-Match", std::string(etag) });
+}
+
+// ───────────────────────────────────────────── Adaptive scheduling
+uint32_t AdaptiveInterval::jitter(uint32_t ms) {
+    uint32_t spread = ms / 100 * ESPGAMEAPI_JITTER_PCT;
+    return spread ? ms - spread + esp_random() % (2 * spread + 1) : ms;
+}
+
+uint32_t AdaptiveInterval::next(uint32_t base) {
+    if (hintMs) {
+        uint32_t ms = hintMs;
+        hintMs = 0;
+        return ms;
+    }
+    uint32_t ms = base;
+    if (boost) {
+        boost--;
+        ms = base / 2;
+    } else {
+        uint32_t cap = base > ESPGAMEAPI_BACKOFF_MAX_MS ? base : ESPGAMEAPI_BACKOFF_MAX_MS;
+        for (uint8_t i = 0; i < level && ms < cap; i++) ms *= 2;
+        if (ms > cap) ms = cap;
+    }
+    return jitter(ms);
+}
+
+void ESPGameAPI::setAdaptiveIntervals(bool enable) {
+    adaptiveIntervals = enable;
+    pollSchedule.reset();
+    postSchedule.reset();
+    holdOff = false;
+    portENTER_CRITICAL(&scheduleLock);
+    scheduleOutcomes.clear();
+    portEXIT_CRITICAL(&scheduleLock);
+    pollGap = pollInterval;
+    updateGap = updateInterval;
+}
+
+// Poll (or tick) answered: failures, overload and a paused game back off;
+// fresh coefficients speed up; Retry-After sets the next gap or, on 429/503,
+// pauses all traffic. Worker task: only records the outcome.
+void ESPGameAPI::adaptPollSchedule(esp_err_t err, int status, const AsyncRequest::Headers& respHeaders, bool changed) {
+    if (!adaptiveIntervals) return;
+    
+    unsigned long retryMs = 0;
+    for (const auto& h : respHeaders) {
+        if (h.first == "Retry-After") retryMs = strtoul(h.second.c_str(), NULL, 10) * 1000UL;
+    }
+    if (retryMs > ESPGAMEAPI_RETRY_AFTER_MAX_MS) retryMs = ESPGAMEAPI_RETRY_AFTER_MAX_MS;
+    
+    ScheduleOutcome o = { SCHED_POLL, STEP_SETTLE, false, static_cast<int16_t>(status), static_cast<uint32_t>(retryMs) };
+    if (err != ESP_OK || status == 429 || status >= 500) {
+        o.step = STEP_BACKOFF;
+    } else if (!isGameActive()) {
+        o.step = STEP_BACKOFF;    // paused: nothing changes until the next round
+    } else if (changed) {
+        o.step = STEP_SPEED_UP;   // more changes tend to follow; a bare 200 is no news
+    }
+    o.holdOff = retryMs && err == ESP_OK && (status == 429 || status == 503);
+    recordOutcome(o);
+}
+
+void ESPGameAPI::adaptPostSchedule(esp_err_t err, int status) {
+    if (!adaptiveIntervals) return;
+    ScheduleOutcome o = { SCHED_POST, STEP_SETTLE, false, static_cast<int16_t>(status), 0 };
+    if (err != ESP_OK || status == 429 || status >= 500) o.step = STEP_BACKOFF;
+    recordOutcome(o);
+}
+
+void ESPGameAPI::recordOutcome(const ScheduleOutcome& o) {
+    portENTER_CRITICAL(&scheduleLock);
+    scheduleOutcomes.push_back(o);
+    portEXIT_CRITICAL(&scheduleLock);
+}
+
+// Loop task: the outcomes recorded since the last update()
+void ESPGameAPI::applyScheduleOutcomes() {
+    FixedList<ScheduleOutcome, 8> pending;
+    portENTER_CRITICAL(&scheduleLock);
+    pending = scheduleOutcomes;
+    scheduleOutcomes.clear();
+    portEXIT_CRITICAL(&scheduleLock);
+    if (!adaptiveIntervals) return;
+    
+    for (const auto& o : pending) {
+        AdaptiveInterval& schedule = o.schedule == SCHED_POLL ? pollSchedule : postSchedule;
+        switch (o.step) {
+            case STEP_BACKOFF:  schedule.backoff(); break;
+            case STEP_SPEED_UP: schedule.speedUp(); break;
+            default:            schedule.settle();  break;
+        }
+        if (o.holdOff) {
+            holdOffUntil = millis() + o.retryMs;
+            holdOff = true;
+            GAME_TRACE(TR_HOLD_OFF, 0, o.status, o.retryMs);
+            GAME_LOG("⏳ Server busy - holding off for %lu ms\n", (unsigned long)o.retryMs);
+        } else if (o.retryMs) {
+            schedule.hint(o.retryMs);
+        }
+    }
+}
+
 // ───────────────────────────────────────────── Async API operations
 void ESPGameAPI::pollCoefficients(CoefficientsCallback callback) {
+    startPoll(false, callback);
+}
+
+void ESPGameAPI::startPoll(bool hold, CoefficientsCallback callback) {
     if (!isRegistered) {
         if (callback) callback(false, "Board not registered");
         return;
     }
     
+    // Held until the completion below; all busy means this server already
+    // has ESPGAMEAPI_POLL_DECODERS polls outstanding
+    PollDecoder* decoder = shared->claimDecoder();
+    if (!decoder) {
+        GAME_LOG("⚠️ Poll skipped - all poll decoders busy\n");
+        if (callback) callback(false, "Poll decoders busy");
+        return;
+    }
     requestPollInFlight = true;
     
+    condHeaders = authHeaders;
+    addPollETag(condHeaders);
+    
+    AsyncRequest::Options opts = requestOptions(AsyncRequest::Priority::POLL, hold ? EP_POLL_WAIT : EP_POLL);
+    opts.collectHeaders = pollResponseHeaders;
+    opts.collectCount   = sizeof(pollResponseHeaders) / sizeof(pollResponseHeaders[0]);
+    
+    opts.sink = decoder;   // decode while the body streams in
+    
+    // Held polls: the server answers once the state changes or the wait expires
+    if (hold) {
+        opts.timeoutMs = (ESPGAMEAPI_LONGPOLL_WAIT_S + 5) * 1000UL;
+        opts.deadlineMs = 0;
+    } else {
+        opts.hedgeAfterMs = AsyncRequest::HEDGE_P95;   // a stuck poll gets a second try
+    }
+    unsigned long sentAt = millis();
+    
     AsyncRequest::fetch(
         AsyncRequest::Method::GET,
-        std::string((baseUrl + "/coreapi/poll_binary").c_str()),
+        shared->urls[hold ? EP_POLL_WAIT : EP_POLL],
         "",
-        { { "Authorization", "Bearer " + std::string(token.c_str()) } },
-        [this, callback](esp_err_t err, int status, std::string body) {
-            requestPollInFlight = false;
+        condHeaders,
+        opts,
+        [this, callback, hold, sentAt, decoder](esp_err_t err, int status, const std::string&, const AsyncRequest::Headers& respHeaders) {
+            Shared::Lease lease = { shared, decoder };
+            // requestPollInFlight is cleared once the state below is written
+            
+            // Long-poll: re-arm at once after a change or a genuine hold; an
+            // instant unchanged reply means the server ignores ?wait, so keep
+            // the pollInterval spacing. Errors always wait.
+            if (hold && err == ESP_OK) {
+                pollImmediately = status == 200 ||
+                    (status == 304 && millis() - sentAt >= ESPGAMEAPI_LONGPOLL_MIN_HOLD_MS);
+            }
             
             if (err != ESP_OK) {
-                Serial.println("❌ Poll coefficients failed: " + String(esp_err_to_name(err)));
+                adaptPollSchedule(err, status, respHeaders);
+                requestPollInFlight = false;
+                GAME_LOG("❌ Poll coefficients failed: %s\n", esp_err_to_name(err));
                 if (callback) callback(false, "Network error: " + std::string(esp_err_to_name(err)));
                 return;
             }
             
+            onPollAnswered(status);
             if (status == 200) {
-                parsePollResponse(reinterpret_cast<const uint8_t*>(body.data()), body.size());
+                bool changed = applyPollResult(*decoder);
+                adaptPollSchedule(err, status, respHeaders, changed);
+                storePollETag(respHeaders);
                 coeffsUpdated = true;
-                Serial.println("✅ Coefficients updated successfully");
+                requestPollInFlight = false;
+                if (callback) callback(true, "");
+            } else if (status == 304) {
+                // Unchanged since pollETag - keep the current state as is
+                adaptPollSchedule(err, status, respHeaders);
+                requestPollInFlight = false;
                 if (callback) callback(true, "");
             } else {
-                Serial.println("❌ Poll coefficients HTTP error: " + String(status));
+                adaptPollSchedule(err, status, respHeaders);
+                requestPollInFlight = false;
+                GAME_LOG("❌ Poll coefficients HTTP error: %d\n", status);
                 if (callback) callback(false, "HTTP error: " + std::to_string(status));
             }
         });
@@ -380,187 +1218,435 @@ void ESPGameAPI::submitPowerData(float production, float consumption, AsyncCallb
         return;
     }
     
-    PowerDataRequest request;
-    request.production = hostToNetworkLong(static_cast<int32_t>(production * 1000));
-    request.consumption = hostToNetworkLong(static_cast<int32_t>(consumption * 1000));
+    uint8_t tag = stageSample(production, consumption);
+    startFrame(txBuf);
+    appendPowerData(txBuf, tag);
     
     requestPostInFlight = true;
-    
-    std::string payload(reinterpret_cast<const char*>(&request), sizeof(request));
-    
-    AsyncRequest::fetch(
-        AsyncRequest::Method::POST,
-        std::string((baseUrl + "/coreapi/post_vals").c_str()),
-        payload,
-        { 
-            { "Authorization", "Bearer " + std::string(token.c_str()) },
-            { "Content-Type", "application/octet-stream" }
-        },
-        [this, callback](esp_err_t err, int status, std::string body) {
-            requestPostInFlight = false;
-            
-            if (err != ESP_OK) {
-                Serial.println("❌ Submit power data failed: " + String(esp_err_to_name(err)));
-                if (callback) callback(false, "Network error: " + std::string(esp_err_to_name(err)));
-                return;
-            }
-            
-            if (status == 200) {
-                Serial.println("✅ Power data submitted successfully");
-                if (callback) callback(true, "");
-            } else {
-                Serial.println("❌ Submit power data HTTP error: " + String(status));
-                if (callback) callback(false, "HTTP error: " + std::to_string(status));
-            }
-        });
+    sendBinary(EP_POST_VALS, AsyncRequest::Priority::TELEMETRY, EP_POST_VALS, callback, tag);
 }
 
-void ESPGameAPI::submitPowerDataWithBuildings(float production, float consumption, const std::vector<ConnectedBuilding>& buildings, AsyncCallback callback) {
+void ESPGameAPI::submitPowerDataWithBuildings(float production, float consumption, ItemView<ConnectedBuilding> buildings, AsyncCallback callback) {
     if (!isRegistered) {
         if (callback) callback(false, "Board not registered");
         return;
     }
     
-    std::vector<uint8_t> data(sizeof(PowerDataRequest));
-    PowerDataRequest* request = reinterpret_cast<PowerDataRequest*>(&data[0]);
-    request->production = hostToNetworkLong(static_cast<int32_t>(production * 1000));
-    request->consumption = hostToNetworkLong(static_cast<int32_t>(consumption * 1000));
+    uint8_t tag = stageSample(production, consumption);
+    startFrame(txBuf);
+    appendPowerData(txBuf, tag);
+    appendBuildings(txBuf, buildings);
     
-    // Add buildings count
-    data.push_back(static_cast<uint8_t>(buildings.size()));
-    
-    // Add buildings
-    for (const auto& building : buildings) {
-        String uid = building.uid;
-        uint8_t building_type = building.building_type;
-        std::string uid_str = std::string(uid.c_str());
-        uint8_t uid_len = uid_str.length();
-        if (uid_len > 255) uid_len = 255;
-        
-        data.push_back(uid_len);
-        for (uint8_t i = 0; i < uid_len; i++) {
-            data.push_back(uid_str[i]);
-        }
-        data.push_back(building_type);
+    requestPostInFlight = true;
+    sendBinary(EP_POST_BUILDINGS, AsyncRequest::Priority::TELEMETRY, EP_POST_VALS, callback, tag);
+}
+
+void ESPGameAPI::reportConnectedPowerPlants(ItemView<ConnectedPowerPlant> plants, AsyncCallback callback) {
+    if (!isRegistered) {
+        if (callback) callback(false, "Board not registered");
+        return;
     }
     
-    std::string payload(reinterpret_cast<const char*>(data.data()), data.size());
-    
-    requestPostInFlight = true;
+    startFrame(txBuf);
+    appendPowerPlants(txBuf, plants);
     
-    AsyncRequest::fetch(
-        AsyncRequest::Method::POST,
-        std::string((baseUrl + "/coreapi/post_vals").c_str()),
-        payload,
-        { 
-            { "Authorization", "Bearer " + std::string(token.c_str()) },
-            { "Content-Type", "application/octet-stream" }
-        },
-        [this, callback](esp_err_t err, int status, std::string body) {
-            requestPostInFlight = false;
-            
-            if (err != ESP_OK) {
-                Serial.println("❌ Submit power data with buildings failed: " + String(esp_err_to_name(err)));
-                if (callback) callback(false, "Network error: " + std::string(esp_err_to_name(err)));
-                return;
-            }
-            
-            if (status == 200) {
-                Serial.println("✅ Power data with buildings submitted successfully");
-                if (callback) callback(true, "");
-            } else {
-                Serial.println("❌ Submit power data with buildings HTTP error: " + String(status));
-                if (callback) callback(false, "HTTP error: " + std::to_string(status));
-            }
-        });
+    sendBinary(EP_PROD_CONNECTED, AsyncRequest::Priority::REPORT, EP_PROD_CONNECTED, callback);
 }
 
-void ESPGameAPI::reportConnectedPowerPlants(const std::vector<ConnectedPowerPlant>& plants, AsyncCallback callback) {
+void ESPGameAPI::reportConnectedConsumers(ItemView<ConnectedConsumer> consumers, AsyncCallback callback) {
     if (!isRegistered) {
         if (callback) callback(false, "Board not registered");
         return;
     }
     
-    std::vector<uint8_t> data(1 + plants.size() * 8);
-    data[0] = static_cast<uint8_t>(plants.size());
-    size_t offset = 1;
+    startFrame(txBuf);
+    appendConsumers(txBuf, consumers);
     
-    for (const auto& plant : plants) {
-        *reinterpret_cast<uint32_t*>(&data[offset]) = hostToNetworkLong(plant.plant_id);
-        *reinterpret_cast<int32_t*>(&data[offset + 4]) = hostToNetworkLong(static_cast<int32_t>(plant.set_power * 1000));
-        offset += 8;
+    sendBinary(EP_CONS_CONNECTED, AsyncRequest::Priority::REPORT, EP_CONS_CONNECTED, callback);
+}
+
+// POSTs txBuf to an acknowledge-only endpoint. Without a user callback the
+// completion captures just [this, ep], which fits std::function's inline
+// storage, so the steady-state path allocates nothing (see
+// AsyncRequest::allocations()).
+void ESPGameAPI::sendBinary(Endpoint ep, AsyncRequest::Priority priority, uint8_t coalesceEndpoint, AsyncCallback callback, uint8_t tag) {
+    const std::string& url = shared->urls[ep];
+    AsyncRequest::Options opts = requestOptions(priority, ep, coalesceEndpoint);
+    opts.pipeline = pipelining;   // unanswered after the write: fails, never re-sent
+    
+    if (callback) {
+        AsyncRequest::fetch(AsyncRequest::Method::POST, url, txBuf.data(), txBuf.size(), binaryHeaders, opts,
+            [this, ep, tag, callback](esp_err_t err, int status, const uint8_t* body, size_t len) { onBinaryDone(ep, tag, err, status, body, len, callback); });
+    } else {
+        AsyncRequest::fetch(AsyncRequest::Method::POST, url, txBuf.data(), txBuf.size(), binaryHeaders, opts,
+            [this, ep, tag](esp_err_t err, int status, const uint8_t* body, size_t len) { onBinaryDone(ep, tag, err, status, body, len, AsyncCallback()); });
     }
+}
+
+// ───────────────────────────────────────────── Local power sampling
+void PowerAggregator::add(float production, float consumption, uint32_t t_ms) {
+    portENTER_CRITICAL(&lock);
+    if (count == 0) {
+        startMs = t_ms;
+        prod.min = prod.max = production;
+        cons.min = cons.max = consumption;
+        prod.energyJ = cons.energyJ = 0;
+    } else {
+        uint32_t dt = t_ms - lastMs;
+        hold(prod, dt);
+        hold(cons, dt);
+        if (production  < prod.min) prod.min = production;
+        if (production  > prod.max) prod.max = production;
+        if (consumption < cons.min) cons.min = consumption;
+        if (consumption > cons.max) cons.max = consumption;
+    }
+    prod.last = production;
+    cons.last = consumption;
+    lastMs = t_ms;
+    count++;
+    portEXIT_CRITICAL(&lock);
+}
+
+void PowerAggregator::close(const Acc& a, Channel& c, uint32_t durationMs) {
+    c.min = a.min;
+    c.max = a.max;
+    c.energyJ = a.energyJ;
+    c.mean = durationMs ? static_cast<float>(a.energyJ * 1000.0 / durationMs) : a.last;
+}
+
+bool PowerAggregator::take(Window& out, uint32_t t_ms) {
+    portENTER_CRITICAL(&lock);
+    if (count == 0) { portEXIT_CRITICAL(&lock); return false; }
+    uint32_t dt = t_ms - lastMs;
+    hold(prod, dt);
+    hold(cons, dt);
+    out.count = count;
+    out.durationMs = t_ms - startMs;
+    close(prod, out.production, out.durationMs);
+    close(cons, out.consumption, out.durationMs);
+    // The last reading carries over as the start of the next window
+    count = 1;
+    startMs = lastMs = t_ms;
+    prod.min = prod.max = prod.last;
+    cons.min = cons.max = cons.last;
+    prod.energyJ = cons.energyJ = 0;
+    portEXIT_CRITICAL(&lock);
+    return true;
+}
+
+void ESPGameAPI::setSamplingInterval(unsigned long ms, bool ownTask) {
+    samplingInterval = ms;
+    if (ms && ownTask && !samplerTask) {
+        xTaskCreatePinnedToCore(samplerTaskMain, "pwrSmp", ESPGAMEAPI_SAMPLER_STACK, this,
+                                ESPGAMEAPI_SAMPLER_PRIORITY, &samplerTask, ESPGAMEAPI_APP_CORE);
+    } else if (samplerTask && (!ms || !ownTask)) {
+        vTaskDelete(samplerTask);
+        samplerTask = NULL;
+    }
+}
+
+void ESPGameAPI::samplerTaskMain(void* arg) {
+    ESPGameAPI* api = static_cast<ESPGameAPI*>(arg);
+    TickType_t wake = xTaskGetTickCount();
+    for (;;) {
+        if (api->productionCallback && api->consumptionCallback) {
+            api->aggregator.add(api->productionCallback(), api->consumptionCallback(), millis());
+        }
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(api->samplingInterval ? api->samplingInterval : 1000));
+    }
+}
+
+// In-loop sampling (when no sampler task runs)
+void ESPGameAPI::samplePower(unsigned long now) {
+    if (!samplingInterval || samplerTask || !productionCallback || !consumptionCallback) return;
+    if (now - lastSampleTime < samplingInterval) return;
+    lastSampleTime = now;
+    aggregator.add(productionCallback(), consumptionCallback(), now);
+}
+
+// Values for one submission: the window's time-weighted means when sampling,
+// else one direct reading
+bool ESPGameAPI::takePowerValues(float& production, float& consumption) {
+    if (samplingInterval && aggregator.take(lastWindow, millis())) {
+        production  = lastWindow.production.mean;
+        consumption = lastWindow.consumption.mean;
+        return true;
+    }
+    production  = productionCallback();
+    consumption = consumptionCallback();
+    return false;
+}
+
+// ───────────────────────────────────────────── Store-and-forward
+uint8_t ESPGameAPI::stageSample(float production, float consumption) {
+    uint8_t tag = postedNext;
+    postedNext = (postedNext + 1) % (sizeof(postedSamples) / sizeof(postedSamples[0]));
+    postedSamples[tag].t_ms        = millis();
+    postedSamples[tag].production  = static_cast<int32_t>(production * 1000);
+    postedSamples[tag].consumption = static_cast<int32_t>(consumption * 1000);
+    postedSeqs[tag] = LEGACY_FRAME;   // appendPowerData() sets it for compact frames
+    return tag;
+}
+
+void ESPGameAPI::bufferSample(float production, float consumption) {
+    sampleRing.push(millis(), static_cast<int32_t>(production * 1000), static_cast<int32_t>(consumption * 1000));
+}
+
+// One post_vals_batch with the oldest buffered samples (re-sent until acked)
+void ESPGameAPI::uploadBacklog() {
+    static PowerSampleRing::Sample batch[ESPGAMEAPI_SAMPLE_BATCH_MAX];   // loop task only
+    uint32_t first;
+    size_t n = sampleRing.peek(batch, ESPGAMEAPI_SAMPLE_BATCH_MAX, &first);
+    if (!n) return;
     
-    std::string payload(reinterpret_cast<const char*>(data.data()), data.size());
+    uint32_t now = millis();
+    txBuf.clear();
+    txBuf.push_back(PROTOCOL_VERSION);
+    Wire::append(txBuf, static_cast<uint16_t>(n));
+    for (size_t i = 0; i < n; i++) {
+        Wire::append(txBuf, PowerSampleEntry{ now - batch[i].t_ms, batch[i].production, batch[i].consumption });
+    }
     
-    AsyncRequest::fetch(
-        AsyncRequest::Method::POST,
-        std::string((baseUrl + "/coreapi/prod_connected").c_str()),
-        payload,
-        { 
-            { "Authorization", "Bearer " + std::string(token.c_str()) },
-            { "Content-Type", "application/octet-stream" }
-        },
-        [callback](esp_err_t err, int status, std::string body) {
-            if (err != ESP_OK) {
-                Serial.println("❌ Report power plants failed: " + String(esp_err_to_name(err)));
-                if (callback) callback(false, "Network error: " + std::string(esp_err_to_name(err)));
-                return;
-            }
-            
-            if (status == 200) {
-                Serial.println("✅ Power plants reported successfully");
-                if (callback) callback(true, "");
-            } else {
-                Serial.println("❌ Report power plants HTTP error: " + String(status));
-                if (callback) callback(false, "HTTP error: " + std::to_string(status));
-            }
-        });
+    GAME_TRACE(TR_BACKLOG, 0, n);
+    backlogEnd = first + n;
+    backlogInFlight = true;
+    sendBinary(EP_POST_BATCH, AsyncRequest::Priority::REPORT, EP_POST_BATCH, nullptr);
+}
+
+void PowerSampleRing::push(uint32_t t_ms, int32_t production, int32_t consumption) {
+    portENTER_CRITICAL(&lock);
+    if (tail - head == ESPGAMEAPI_SAMPLE_BUFFER_LEN) { head++; overwritten++; }
+    Sample& s = buf[tail % ESPGAMEAPI_SAMPLE_BUFFER_LEN];
+    s.t_ms = t_ms; s.production = production; s.consumption = consumption;
+    tail++;
+    portEXIT_CRITICAL(&lock);
+}
+
+size_t PowerSampleRing::size() const {
+    portENTER_CRITICAL(&lock);
+    size_t n = tail - head;
+    portEXIT_CRITICAL(&lock);
+    return n;
+}
+
+size_t PowerSampleRing::peek(Sample* out, size_t max, uint32_t* firstSeq) const {
+    portENTER_CRITICAL(&lock);
+    size_t n = tail - head;
+    if (n > max) n = max;
+    for (size_t i = 0; i < n; i++) out[i] = buf[(head + i) % ESPGAMEAPI_SAMPLE_BUFFER_LEN];
+    *firstSeq = head;
+    portEXIT_CRITICAL(&lock);
+    return n;
+}
+
+void PowerSampleRing::releaseBefore(uint32_t seq) {
+    portENTER_CRITICAL(&lock);
+    // Samples already overwritten are gone anyway
+    if ((int32_t)(seq - head) > 0) head = (int32_t)(seq - tail) > 0 ? tail : seq;
+    portEXIT_CRITICAL(&lock);
+}
+
+void ESPGameAPI::onBinaryDone(Endpoint ep, uint8_t tag, esp_err_t err, int status, const uint8_t* body, size_t len, const AsyncCallback& callback) {
+    const char* what;
+    switch (ep) {
+        case EP_POST_VALS:      what = "Submit power data"; break;
+        case EP_POST_BUILDINGS: what = "Submit power data with buildings"; break;
+        case EP_PROD_CONNECTED: what = "Report power plants"; break;
+        case EP_METRICS:        what = "Report metrics"; break;
+        case EP_POST_BATCH:     what = "Upload buffered samples"; break;
+        default:                what = "Report consumers"; break;
+    }
+    if (ep == EP_POST_VALS || ep == EP_POST_BUILDINGS) {
+        requestPostInFlight = false;
+        adaptPostSchedule(err, status);
+    }
+    
+    // Store-and-forward bookkeeping: a sample the server never got (network
+    // error, superseded in the queue, 5xx) goes back into the ring; an
+    // acknowledged batch releases exactly the samples it carried.
+    bool delivered = err == ESP_OK && status == 200;
+    bool retryable = err != ESP_OK || status >= 500 || status == 401 || status == 409;
+    bool sample = tag != NO_SAMPLE && (ep == EP_POST_VALS || ep == EP_POST_BUILDINGS);
+    if (sample && delivered) recordPowerAck(tag);
+    if (err == ESP_OK && status == 409) powerRejected = true;   // compact base unknown: key frame next
+    if (ep == EP_POST_BUILDINGS && delivered && postedSeqs[tag] != LEGACY_FRAME) recordIndexReply(body, len);
+    if (tag != NO_SAMPLE && delivered && ep == EP_PROD_CONNECTED) plantsAcked = tag;
+    if (tag != NO_SAMPLE && delivered && ep == EP_CONS_CONNECTED) consumersAcked = tag;
+    if (sample && !delivered && retryable) {
+        const PowerSampleRing::Sample& smp = postedSamples[tag];
+        sampleRing.push(smp.t_ms, smp.production, smp.consumption);
+    }
+    if (ep == EP_POST_BATCH) {
+        if (delivered) sampleRing.releaseBefore(backlogEnd);
+        backlogInFlight = false;
+    }
+    
+    if (err != ESP_OK) {
+        GAME_TRACE(TR_FAILED, ep, 0, err);
+        GAME_LOG("❌ %s failed: %s\n", what, esp_err_to_name(err));
+        if (callback) callback(false, "Network error: " + std::string(esp_err_to_name(err)));
+        return;
+    }
+    
+    if (status == 401) onAuthExpired();
+    if (status == 200) {
+        if (callback) callback(true, "");
+    } else {
+        GAME_TRACE(TR_FAILED, ep, status);
+        GAME_LOG("❌ %s HTTP error: %d\n", what, status);
+        if (callback) callback(false, "HTTP error: " + std::to_string(status));
+    }
 }
 
-void ESPGameAPI::reportConnectedConsumers(const std::vector<ConnectedConsumer>& consumers, AsyncCallback callback) {
+void ESPGameAPI::exchangeTick(bool includeReports, AsyncCallback callback) {
     if (!isRegistered) {
         if (callback) callback(false, "Board not registered");
         return;
     }
     
-    std::vector<uint8_t> data(1 + consumers.size() * 4);
-    data[0] = static_cast<uint8_t>(consumers.size());
-    size_t offset = 1;
+    // [version][sections][power][plants][consumers][buildings] - absent
+    // sections are simply skipped, so the server decodes by the flag byte
+    PollDecoder* decoder = shared->claimDecoder();
+    if (!decoder) {
+        GAME_LOG("⚠️ Combined exchange skipped - all poll decoders busy\n");
+        if (callback) callback(false, "Poll decoders busy");
+        return;
+    }
     
-    for (const auto& consumer : consumers) {
-        *reinterpret_cast<uint32_t*>(&data[offset]) = hostToNetworkLong(consumer.consumer_id);
-        offset += 4;
+    txBuf.clear();
+    txBuf.push_back(useCompact() ? PROTOCOL_VERSION_COMPACT : PROTOCOL_VERSION);
+    txBuf.push_back(0);
+    uint8_t sections = 0;
+    uint8_t tag = NO_SAMPLE, plantsTag = NO_SAMPLE, consumersTag = NO_SAMPLE;
+    
+    if (includeReports) {
+        if (productionCallback && consumptionCallback) {
+            float production, consumption;
+            takePowerValues(production, consumption);
+            tag = stageSample(production, consumption);
+            appendPowerData(txBuf, tag);
+            sections |= TICK_SECTION_POWER;
+        }
+        // Unchanged device lists are left out; the server keeps the last ones
+        unsigned long now = millis();
+        if (hasPlants()) {
+            ItemView<ConnectedPowerPlant> plants = currentPlants();
+            if (plantsReportDue(plants, now)) {
+                plantsTag = stagePlantsReport(plants);
+                appendPowerPlants(txBuf, plants);
+                sections |= TICK_SECTION_PLANTS;
+            }
+        }
+        if (hasConsumers()) {
+            ItemView<ConnectedConsumer> consumers = currentConsumers();
+            if (consumersReportDue(consumers, now)) {
+                consumersTag = stageConsumersReport(consumers);
+                appendConsumers(txBuf, consumers);
+                sections |= TICK_SECTION_CONSUMERS;
+            }
+        }
+        if (!connectedBuildings.empty()) {
+            appendBuildings(txBuf, connectedBuildings);
+            sections |= TICK_SECTION_BUILDINGS;
+        }
     }
+    txBuf[1] = sections;
+    
+    // In push mode the long-poll owns requestPollInFlight
+    bool ownsPoll = !pushMode;
+    if (ownsPoll) requestPollInFlight = true;
+    requestPostInFlight = true;
     
-    std::string payload(reinterpret_cast<const char*>(data.data()), data.size());
+    condHeaders = binaryHeaders;
+    addPollETag(condHeaders);
+    
+    AsyncRequest::Options opts = requestOptions(AsyncRequest::Priority::POLL, EP_TICK);
+    opts.collectHeaders = pollResponseHeaders;
+    opts.collectCount   = sizeof(pollResponseHeaders) / sizeof(pollResponseHeaders[0]);
+    
+    opts.sink = decoder;
     
     AsyncRequest::fetch(
         AsyncRequest::Method::POST,
-        std::string((baseUrl + "/coreapi/cons_connected").c_str()),
-        payload,
-        { 
-            { "Authorization", "Bearer " + std::string(token.c_str()) },
-            { "Content-Type", "application/octet-stream" }
-        },
-        [callback](esp_err_t err, int status, std::string body) {
+        shared->urls[EP_TICK],
+        txBuf.data(), txBuf.size(),
+        condHeaders,
+        opts,
+        [this, callback, ownsPoll, sections, tag, plantsTag, consumersTag, decoder](esp_err_t err, int status, const std::string&, const AsyncRequest::Headers& respHeaders) {
+            Shared::Lease lease = { shared, decoder };
+            // In-flight flags are cleared last, once the state below is written
+            auto release = [this, ownsPoll]() {
+                if (ownsPoll) requestPollInFlight = false;
+                requestPostInFlight = false;
+            };
+            if (sections & TICK_SECTION_POWER) adaptPostSchedule(err, status);
+            
+            // The power sample goes to the store-and-forward ring unless acknowledged
+            bool delivered = err == ESP_OK && (status == 200 || status == 304);
+            if (tag != NO_SAMPLE && delivered) recordPowerAck(tag);
+            if (err == ESP_OK && status == 409) powerRejected = true;
+            if (tag != NO_SAMPLE && !delivered &&
+                (err != ESP_OK || status >= 500 || status == 401 || status == 409)) {
+                const PowerSampleRing::Sample& smp = postedSamples[tag];
+                sampleRing.push(smp.t_ms, smp.production, smp.consumption);
+            }
+            
             if (err != ESP_OK) {
-                Serial.println("❌ Report consumers failed: " + String(esp_err_to_name(err)));
+                adaptPollSchedule(err, status, respHeaders);
+                release();
+                GAME_LOG("❌ Combined exchange failed: %s\n", esp_err_to_name(err));
                 if (callback) callback(false, "Network error: " + std::string(esp_err_to_name(err)));
                 return;
             }
             
-            if (status == 200) {
-                Serial.println("✅ Consumers reported successfully");
+            onPollAnswered(status);
+            if (status == 200 || status == 304) {
+                if (plantsTag != NO_SAMPLE)    plantsAcked = plantsTag;
+                if (consumersTag != NO_SAMPLE) consumersAcked = consumersTag;
+                bool changed = false;
+                if (status == 200) {
+                    changed = applyPollResult(*decoder);
+                    storePollETag(respHeaders);
+                    coeffsUpdated = true;
+                }
+                adaptPollSchedule(err, status, respHeaders, changed);
+                release();
                 if (callback) callback(true, "");
+            } else if (status == 404 || status == 405 || status == 501) {
+                // Server predates tick_binary - go back to per-endpoint requests
+                // and let the next update() send them right away.
+                combinedSupported = false;
+                lastPollTime = millis();
+                lastUpdateTime = millis();
+                pollGap = updateGap = 0;
+                release();
+                GAME_LOG("⚠️ Combined exchange not supported by server, falling back\n");
+                if (callback) callback(false, "Combined exchange not supported");
             } else {
-                Serial.println("❌ Report consumers HTTP error: " + String(status));
+                adaptPollSchedule(err, status, respHeaders);
+                release();
+                GAME_LOG("❌ Combined exchange HTTP error: %d\n", status);
                 if (callback) callback(false, "HTTP error: " + std::to_string(status));
             }
         });
 }
 
 void ESPGameAPI::getProductionRanges(ProductionRangeCallback callback) {
+    // Legacy signature: the one copy into a vector happens only here
+    requestProductionRanges([callback](bool success, ItemView<ProductionRange> ranges, const std::string& error) {
+        if (callback) callback(success, std::vector<ProductionRange>(ranges.begin(), ranges.end()), error);
+    });
+}
+
+void ESPGameAPI::getConsumptionValues(ConsumptionValCallback callback) {
+    requestConsumptionValues([callback](bool success, ItemView<ConsumptionCoefficient> coeffs, const std::string& error) {
+        if (callback) callback(success, std::vector<ConsumptionCoefficient>(coeffs.begin(), coeffs.end()), error);
+    });
+}
+
+// Both responses are parsed straight into the back snapshot and the callback
+// gets a view of the published list (valid like snapshot(), see snapshotValid())
+void ESPGameAPI::requestProductionRanges(ProductionRangeViewCallback callback) {
     if (!isRegistered) {
         if (callback) callback(false, {}, "Board not registered");
         return;
@@ -575,36 +1661,39 @@ void ESPGameAPI::getProductionRanges(ProductionRangeCallback callback) {
     
     AsyncRequest::fetch(
         AsyncRequest::Method::GET,
-        std::string((baseUrl + "/coreapi/prod_vals").c_str()),
-        "",
-        { { "Authorization", "Bearer " + std::string(token.c_str()) } },
-        [this, callback](esp_err_t err, int status, std::string body) {
+        shared->urls[EP_PROD_VALS],
+        NULL, 0,
+        authHeaders,
+        hedgedOptions(EP_PROD_VALS),
+        [this, callback](esp_err_t err, int status, const uint8_t* body, size_t len) {
             requestRangesInFlight = false;
             
             if (err != ESP_OK) {
-                Serial.println("❌ Get production ranges failed: " + String(esp_err_to_name(err)));
+                GAME_LOG("❌ Get production ranges failed: %s\n", esp_err_to_name(err));
                 if (callback) callback(false, {}, "Network error: " + std::string(esp_err_to_name(err)));
                 return;
             }
             
             if (status == 200) {
-                std::vector<ProductionRange> ranges;
-                if (parseProductionRanges(reinterpret_cast<const uint8_t*>(body.data()), body.size())) {
-                    ranges = productionRanges;
-                    Serial.println("✅ Production ranges retrieved successfully");
-                    if (callback) callback(true, ranges, "");
+                if (rangesFrameValid(body, len)) {
+                    GameSnapshot& next = beginPublish();
+                    parseProductionRanges(body, len, next.ranges);
+                    endPublish();
+                    GAME_LOG("✅ Production ranges retrieved successfully\n");
+                    if (callback) callback(true, next.ranges, "");
                 } else {
-                    Serial.println("❌ Failed to parse production ranges");
+                    GAME_LOG("❌ Failed to parse production ranges\n");
                     if (callback) callback(false, {}, "Failed to parse response");
                 }
             } else {
-                Serial.println("❌ Get production ranges HTTP error: " + String(status));
+                if (status == 401) onAuthExpired();
+                GAME_LOG("❌ Get production ranges HTTP error: %d\n", status);
                 if (callback) callback(false, {}, "HTTP error: " + std::to_string(status));
             }
         });
 }
 
-void ESPGameAPI::getConsumptionValues(ConsumptionValCallback callback) {
+void ESPGameAPI::requestConsumptionValues(ConsumptionValViewCallback callback) {
     if (!isRegistered) {
         if (callback) callback(false, {}, "Board not registered");
         return;
@@ -612,64 +1701,248 @@ void ESPGameAPI::getConsumptionValues(ConsumptionValCallback callback) {
     
     AsyncRequest::fetch(
         AsyncRequest::Method::GET,
-        std::string((baseUrl + "/coreapi/cons_vals").c_str()),
-        "",
-        { { "Authorization", "Bearer " + std::string(token.c_str()) } },
-        [this, callback](esp_err_t err, int status, std::string body) {
+        shared->urls[EP_CONS_VALS],
+        NULL, 0,
+        authHeaders,
+        hedgedOptions(EP_CONS_VALS),
+        [this, callback](esp_err_t err, int status, const uint8_t* body, size_t len) {
             if (err != ESP_OK) {
-                Serial.println("❌ Get consumption values failed: " + String(esp_err_to_name(err)));
+                GAME_LOG("❌ Get consumption values failed: %s\n", esp_err_to_name(err));
                 if (callback) callback(false, {}, "Network error: " + std::string(esp_err_to_name(err)));
                 return;
             }
             
             if (status == 200) {
-                std::vector<ConsumptionCoefficient> coeffs;
-                if (parseConsumptionCoefficients(reinterpret_cast<const uint8_t*>(body.data()), body.size())) {
-                    coeffs = consumptionCoefficients;
-                    Serial.println("✅ Consumption values retrieved successfully");
-                    if (callback) callback(true, coeffs, "");
+                if (consumptionFrameValid(body, len)) {
+                    GameSnapshot& next = beginPublish();
+                    parseConsumptionCoefficients(body, len, next.consumption);
+                    endPublish();
+                    GAME_LOG("✅ Consumption values retrieved successfully\n");
+                    if (callback) callback(true, next.consumption, "");
                 } else {
-                    Serial.println("❌ Failed to parse consumption values");
+                    GAME_LOG("❌ Failed to parse consumption values\n");
                     if (callback) callback(false, {}, "Failed to parse response");
                 }
             } else {
-                Serial.println("❌ Get consumption values HTTP error: " + String(status));
+                if (status == 401) onAuthExpired();
+                GAME_LOG("❌ Get consumption values HTTP error: %d\n", status);
                 if (callback) callback(false, {}, "HTTP error: " + std::to_string(status));
             }
         });
 }
+// ───────────────────────────────────────────── Metrics
+// Metrics are ~4 KB: each call takes its own snapshot on the heap rather
+// than the caller's stack, so concurrent callers and instances never share one
+static std::unique_ptr<AsyncRequest::Metrics> takeMetrics() {
+    std::unique_ptr<AsyncRequest::Metrics> m(new (std::nothrow) AsyncRequest::Metrics());
+    if (m) AsyncRequest::metrics(*m);
+    return m;
+}
+
+void ESPGameAPI::appendPercentiles(std::vector<uint8_t>& data, const AsyncRequest::Histogram& h) {
+    appendU32(data, h.percentile(50));
+    appendU32(data, h.percentile(95));
+    appendU32(data, h.percentile(99));
+    appendU32(data, h.maxMs);
+}
+
+// [version][requests][queue_full][superseded][begin_fail][new_conn][reused_conn]
+// [bytes_in][bytes_out][max_depth u8][inQ p50/p95/p99/max][connect ...][body ...]
+// [slot_count u8] then per used slot: [endpoint u8][count][errors][http_errors]
+// [total p50/p95/p99/max] - all u32 big-endian unless noted
+void ESPGameAPI::reportMetrics(AsyncCallback callback) {
+    if (!isRegistered) {
+        if (callback) callback(false, "Board not registered");
+        return;
+    }
+    
+    std::unique_ptr<AsyncRequest::Metrics> snapshot = takeMetrics();
+    if (!snapshot) {
+        if (callback) callback(false, "Out of memory");
+        return;
+    }
+    const AsyncRequest::Metrics& m = *snapshot;
+    
+    txBuf.clear();
+    txBuf.push_back(PROTOCOL_VERSION);
+    appendU32(txBuf, m.requests);
+    appendU32(txBuf, m.queueFull);
+    appendU32(txBuf, m.superseded);
+    appendU32(txBuf, m.beginFail);
+    appendU32(txBuf, m.newConnections);
+    appendU32(txBuf, m.reusedConnections);
+    appendU32(txBuf, m.bytesIn);
+    appendU32(txBuf, m.bytesOut);
+    txBuf.push_back(m.maxQueueDepth);
+    appendPercentiles(txBuf, m.inQueue);
+    appendPercentiles(txBuf, m.connect);
+    appendPercentiles(txBuf, m.body);
+    
+    size_t countAt = txBuf.size();
+    txBuf.push_back(0);
+    for (uint8_t i = 0; i < ASYNCREQUEST_METRIC_SLOTS; i++) {
+        const AsyncRequest::SlotMetrics& sm = m.slot[i];
+        if (!sm.total.count) continue;
+        txBuf.push_back(i);
+        appendU32(txBuf, sm.total.count);
+        appendU32(txBuf, sm.errors);
+        appendU32(txBuf, sm.httpErrors);
+        appendPercentiles(txBuf, sm.total);
+        txBuf[countAt]++;
+    }
+    
+    sendBinary(EP_METRICS, AsyncRequest::Priority::REPORT, EP_METRICS, callback);
+}
+
+void ESPGameAPI::printMetrics() const {
+    std::unique_ptr<AsyncRequest::Metrics> snapshot = takeMetrics();
+    if (!snapshot) return;
+    const AsyncRequest::Metrics& m = *snapshot;
+    
+    Serial.println();
+    Serial.println("=== Request Metrics ===");
+    Serial.printf("Requests: %u  queue_full: %u  superseded: %u  beginFail: %u\n",
+                  (unsigned)m.requests, (unsigned)m.queueFull, (unsigned)m.superseded, (unsigned)m.beginFail);
+    Serial.printf("Connections: %u new, %u reused  Bytes: %u in, %u out  Max queue: %u\n",
+                  (unsigned)m.newConnections, (unsigned)m.reusedConnections,
+                  (unsigned)m.bytesIn, (unsigned)m.bytesOut, (unsigned)m.maxQueueDepth);
+    Serial.printf("DNS: %u cached, %u resolved, %u stale\n",
+                  (unsigned)m.dnsHits, (unsigned)m.dnsLookups, (unsigned)m.dnsStale);
+    Serial.printf("Deadline misses: %u  cancelled: %u  hedged: %u (%u won)\n",
+                  (unsigned)m.deadlineMisses, (unsigned)m.cancelled, (unsigned)m.hedged, (unsigned)m.hedgeWins);
+    Serial.printf("inQ p50/p95/p99: %u/%u/%u ms  connect: %u/%u/%u ms  body: %u/%u/%u ms\n",
+                  (unsigned)m.inQueue.percentile(50), (unsigned)m.inQueue.percentile(95), (unsigned)m.inQueue.percentile(99),
+                  (unsigned)m.connect.percentile(50), (unsigned)m.connect.percentile(95), (unsigned)m.connect.percentile(99),
+                  (unsigned)m.body.percentile(50),    (unsigned)m.body.percentile(95),    (unsigned)m.body.percentile(99));
+    for (uint8_t i = 0; i < EP_COUNT; i++) {
+        const AsyncRequest::SlotMetrics& sm = m.slot[i];
+        if (!sm.total.count) continue;
+        Serial.printf("  %-24s n=%u err=%u http=%u  p50=%u p95=%u p99=%u max=%u ms\n",
+                      metricsSlotName(i),
+                      (unsigned)sm.total.count, (unsigned)sm.errors, (unsigned)sm.httpErrors,
+                      (unsigned)sm.total.percentile(50), (unsigned)sm.total.percentile(95),
+                      (unsigned)sm.total.percentile(99), (unsigned)sm.total.maxMs);
+    }
+    Serial.println("=======================");
+}
+
+// Stack figures are high-water marks: the least free stack since the task started
+void ESPGameAPI::printTaskStatus() const {
+    Serial.println();
+    Serial.println("=== Tasks ===");
+    Serial.println("loop: core " + String((int)xPortGetCoreID()) + ", " +
+                   String((unsigned)uxTaskGetStackHighWaterMark(NULL)) + " B stack free");
+    String workerCore = AsyncRequest::workerCore() == tskNO_AFFINITY ? String("any") : String((int)AsyncRequest::workerCore());
+    for (uint8_t i = 0; i < AsyncRequest::workerCount(); i++) {
+        Serial.println("reqW" + String(i) + ": core " + workerCore +
+                       ", prio " + String((unsigned)AsyncRequest::workerPriority()) + ", " +
+                       String((unsigned)AsyncRequest::workerStackFree(i)) + "/" +
+                       String((unsigned)AsyncRequest::workerStack()) + " B stack free");
+    }
+    if (samplerTask) {
+        Serial.println("pwrSmp: core " + String(ESPGAMEAPI_APP_CORE) + ", prio " + String(ESPGAMEAPI_SAMPLER_PRIORITY) + ", " +
+                       String((unsigned)uxTaskGetStackHighWaterMark(samplerTask)) + "/" +
+                       String(ESPGAMEAPI_SAMPLER_STACK) + " B stack free");
+    }
+}
+
 // ───────────────────────────────────────────── Non‑blocking loop helper
 bool ESPGameAPI::update(){
-    if(!isConnected()) return false;
-
+    // Run deferred completions first so scheduling below sees their results
+    AsyncRequest::poll();
+    applyLogin();
+    applySession();
+    applyCompactAcks();
+    applyScheduleOutcomes();
     unsigned long now = millis();
+    samplePower(now);
+    advanceConnection(now);
+    if(!isConnected()){
+        // Keep sampling through outages so the energy accounting stays complete
+        if(isGameActive() && productionCallback && consumptionCallback && now - lastUpdateTime >= updateInterval){
+            lastUpdateTime = now;
+            float production, consumption;
+            takePowerValues(production, consumption);
+            bufferSample(production, consumption);
+        }
+        return false;
+    }
+    
+    // Server asked for a pause (Retry-After on 429/503): send nothing until it ends
+    if(holdOff){
+        if((long)(holdOffUntil - now) > 0) return false;
+        holdOff = false;
+    }
+    
+    // A game just started: spread the first post_vals of all boards over one
+    // interval instead of every board posting in the same tick
+    bool active = isGameActive();
+    if(adaptiveIntervals && active && !wasGameActive){
+        lastUpdateTime = now;
+        updateGap = esp_random() % (updateInterval + 1);
+        postSchedule.reset();
+    }
+    wasGameActive = active;
+    
+    // Catch up on buffered samples, one batch at a time
+    if(!backlogInFlight && sampleRing.size()) uploadBacklog();
+    
+    // Push mode: one long-poll stays outstanding and owns coefficient updates
+    if(pushMode && !requestPollInFlight && (pollImmediately || now - lastPollTime >= pollGap)){
+        lastPollTime = now;
+        pollGap = nextPollGap();
+        pollImmediately = false;
+        startPoll(true, nullptr);
+    }
+    
+    if(isCombinedExchangeActive()){
+        // One round trip carries both the poll and (when due) the reports
+        bool pollDue = !pushMode && now - lastPollTime >= pollGap;
+        bool postDue = active && now - lastUpdateTime >= updateGap;
+        if((pushMode || !requestPollInFlight) && !requestPostInFlight && (pollDue || postDue)){
+            if(pollDue) { lastPollTime = now;   pollGap = nextPollGap(); }
+            if(postDue) { lastUpdateTime = now; updateGap = nextUpdateGap(); }
+            exchangeTick(postDue);
+        }
+        
+        bool ret = coeffsUpdated;
+        coeffsUpdated = false;
+        return ret;
+    }
     
     // Schedule coefficient poll
-    if(!requestPollInFlight && now - lastPollTime >= pollInterval){
+    if(!pushMode && !requestPollInFlight && now - lastPollTime >= pollGap){
         lastPollTime = now;
+        pollGap = nextPollGap();
         pollCoefficients();  // fire‑and‑forget with internal callback
     }
     
-    // Schedule power data submission
-    if(gameActive && !requestPostInFlight && now - lastUpdateTime >= updateInterval){
+    // Setpoints moved (see notifyPlantsChanged()): report them now
+    if(plantsChanged && active){
+        plantsChanged = false;
+        reportPlantsIfChanged(now);
+    }
+    
+    // Schedule power data submission. No in-flight gate: a newer sample
+    // replaces one still waiting in the AsyncRequest queue (coalescing).
+    if(active && now - lastUpdateTime >= updateGap){
         lastUpdateTime = now;
+        updateGap = nextUpdateGap();
+        // Queue this tick's reports together so they can share one round trip
+        AsyncRequest::Batch batch;
 
-        // Report connected power plants if callback is set
-        if(powerPlantsCallback) {
-            reportConnectedPowerPlants(powerPlantsCallback());
-        }
-        
-        // Report connected consumers if callback is set
-        if(consumersCallback) {
-            reportConnectedConsumers(consumersCallback());
-        }
+        // Report connected devices only when the lists changed (or refresh is due)
+        reportPlantsIfChanged(now);
+        reportConsumersIfChanged(now);
 
         // Submit power data if both callbacks are set
         if(productionCallback && consumptionCallback) {
+            float production, consumption;
+            takePowerValues(production, consumption);
             if (!connectedBuildings.empty()) {
-                submitPowerDataWithBuildings(productionCallback(), consumptionCallback(), connectedBuildings);
+                submitPowerDataWithBuildings(production, consumption, connectedBuildings);
             } else {
-                submitPowerData(productionCallback(), consumptionCallback());
+                submitPowerData(production, consumption);
             }
         }
     }
@@ -681,19 +1954,23 @@ bool ESPGameAPI::update(){
 
 // ───────────────────────────────────────────── Debug helpers (silenced unless enabled)
 void ESPGameAPI::printStatus() const {
+    const GameSnapshot& state = snapshot();
     Serial.println();
     Serial.println("=== ESP Game API Status ===");
     Serial.println("Board Name: " + boardName);
     Serial.println("Board Type: " + boardTypeToString(boardType));
     Serial.println("Logged In: " + String(isLoggedIn ? "Yes" : "No"));
     Serial.println("Registered: " + String(isRegistered ? "Yes" : "No"));
-    Serial.println("Game Active: " + String(gameActive ? "Yes" : "No"));
+    Serial.println("Game Active: " + String(state.gameActive ? "Yes" : "No"));
     Serial.println("WiFi Connected: " + String(WiFi.status() == WL_CONNECTED ? "Yes" : "No"));
     Serial.println("Update Interval: " + String(updateInterval) + "ms");
     Serial.println("Poll Interval: " + String(pollInterval) + "ms");
-    Serial.println("Production Coefficients: " + String(productionCoefficients.size()));
-    Serial.println("Production Ranges: " + String(productionRanges.size()));
-    Serial.println("Consumption Coefficients: " + String(consumptionCoefficients.size()));
+    if (adaptiveIntervals) {
+        Serial.println("Adaptive Gaps: poll " + String(pollGap) + "ms, update " + String(updateGap) + "ms");
+    }
+    Serial.println("Production Coefficients: " + String(state.production.size()));
+    Serial.println("Production Ranges: " + String(state.ranges.size()));
+    Serial.println("Consumption Coefficients: " + String(state.consumption.size()));
     Serial.println("Callbacks Set:");
     Serial.println("  Production: " + String(productionCallback ? "Yes" : "No"));
     Serial.println("  Consumption: " + String(consumptionCallback ? "Yes" : "No"));
@@ -703,21 +1980,22 @@ void ESPGameAPI::printStatus() const {
 }
 
 void ESPGameAPI::printCoefficients() const {
+    const GameSnapshot& state = snapshot();
     Serial.println();
     Serial.println("=== Game Coefficients ===");
     
-    Serial.println("Production Coefficients (" + String(productionCoefficients.size()) + "):");
-    for (const auto& coeff : productionCoefficients) {
+    Serial.println("Production Coefficients (" + String(state.production.size()) + "):");
+    for (const auto& coeff : state.production) {
         Serial.println("  Source " + String(coeff.source_id) + ": " + String(coeff.coefficient, 3) + "W");
     }
     
-    Serial.println("Production Ranges (" + String(productionRanges.size()) + "):");
-    for (const auto& range : productionRanges) {
+    Serial.println("Production Ranges (" + String(state.ranges.size()) + "):");
+    for (const auto& range : state.ranges) {
         Serial.println("  Source " + String(range.source_id) + ": " + String(range.min_power, 1) + "W - " + String(range.max_power, 1) + "W");
     }
     
-    Serial.println("Consumption Coefficients (" + String(consumptionCoefficients.size()) + "):");
-    for (const auto& coeff : consumptionCoefficients) {
+    Serial.println("Consumption Coefficients (" + String(state.consumption.size()) + "):");
+    for (const auto& coeff : state.consumption) {
         Serial.println("  Building " + String(coeff.building_id) + ": " + String(coeff.consumption, 3) + "W");
     }
     
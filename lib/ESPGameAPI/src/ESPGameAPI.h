@@ -5,7 +5,9 @@
 #include <WiFi.h>
 #include <vector>
 #include <functional>
+#include <freertos/semphr.h>
 #include "AsyncRequest.hpp"
+#include "WireFormat.h"
 
 // Forward declaration for certificate bundle
 extern "C" {
@@ -26,40 +28,418 @@ extern "C" {
 #endif
 // ─────────────────────────────────
 
+#define ESPGAMEAPI_XSTR(x) #x
+#define ESPGAMEAPI_STR(x)  ESPGAMEAPI_XSTR(x)
+
 // Protocol version
 #define PROTOCOL_VERSION 0x01
+#define PROTOCOL_VERSION_COMPACT 0x02     // varint/delta frames (setCompactProtocol())
 #define POWER_NULL_VALUE 0x7FFFFFFF       // special power value
 #define FLAG_GENERATION_PRESENT 0x01
 #define FLAG_CONSUMPTION_PRESENT 0x02
 
+// Device report dirty tracking: unchanged plant/consumer sets are re-sent at
+// most this often as a safety net (0 = send on every update, legacy behaviour)
+#ifndef ESPGAMEAPI_REPORT_REFRESH_MS
+#define ESPGAMEAPI_REPORT_REFRESH_MS 30000
+#endif
+
+// Push (long-poll) mode: how long the server may hold poll_binary open, and the
+// shortest hold that counts as "server supports it" - unchanged replies that
+// come back faster fall back to the regular pollInterval spacing.
+#ifndef ESPGAMEAPI_LONGPOLL_WAIT_S
+#define ESPGAMEAPI_LONGPOLL_WAIT_S 25
+#endif
+#ifndef ESPGAMEAPI_LONGPOLL_MIN_HOLD_MS
+#define ESPGAMEAPI_LONGPOLL_MIN_HOLD_MS 1000
+#endif
+
+// Longest poll ETag kept for If-None-Match (longer ones are not sent back)
+#ifndef ESPGAMEAPI_ETAG_LEN
+#define ESPGAMEAPI_ETAG_LEN 64
+#endif
+
+// Connection pipeline: delay between failed login/register attempts, and how
+// long the blocking login()/registerBoard() wrappers wait for an answer
+#ifndef ESPGAMEAPI_CONNECT_RETRY_MS
+#define ESPGAMEAPI_CONNECT_RETRY_MS 5000
+#endif
+#ifndef ESPGAMEAPI_AUTH_TIMEOUT_MS
+#define ESPGAMEAPI_AUTH_TIMEOUT_MS 10000
+#endif
+
+// Every request fails with ESP_ERR_TIMEOUT once it is this old, whether still
+// queued or running (held polls excepted, their own timeout bounds them)
+#ifndef ESPGAMEAPI_REQUEST_DEADLINE_MS
+#define ESPGAMEAPI_REQUEST_DEADLINE_MS 15000
+#endif
+
+// Store-and-forward: samples kept while offline or after a failed post_vals,
+// and how many go into one post_vals_batch upload
+#ifndef ESPGAMEAPI_SAMPLE_BUFFER_LEN
+#define ESPGAMEAPI_SAMPLE_BUFFER_LEN 128
+#endif
+#ifndef ESPGAMEAPI_SAMPLE_BATCH_MAX
+#define ESPGAMEAPI_SAMPLE_BATCH_MAX 64
+#endif
+
+// Adaptive intervals (setAdaptiveIntervals()): longest backed-off gap, random
+// spread applied to every gap, polls kept at half spacing after a coefficient
+// change, and the largest Retry-After honoured
+#ifndef ESPGAMEAPI_BACKOFF_MAX_MS
+#define ESPGAMEAPI_BACKOFF_MAX_MS 60000
+#endif
+#ifndef ESPGAMEAPI_JITTER_PCT
+#define ESPGAMEAPI_JITTER_PCT 20
+#endif
+#ifndef ESPGAMEAPI_FAST_POLLS
+#define ESPGAMEAPI_FAST_POLLS 3
+#endif
+#ifndef ESPGAMEAPI_RETRY_AFTER_MAX_MS
+#define ESPGAMEAPI_RETRY_AFTER_MAX_MS 300000
+#endif
+
+// Core for the library's application tasks (sampler, PowerController): the
+// one loop() runs on, while AsyncRequest's workers sit on core 0
+#ifndef ESPGAMEAPI_APP_CORE
+#ifdef ARDUINO_RUNNING_CORE
+#define ESPGAMEAPI_APP_CORE ARDUINO_RUNNING_CORE
+#else
+#define ESPGAMEAPI_APP_CORE 1
+#endif
+#endif
+
+// Local power sampling (setSamplingInterval()): stack and priority of the
+// optional sampler task
+#ifndef ESPGAMEAPI_SAMPLER_STACK
+#define ESPGAMEAPI_SAMPLER_STACK 3072
+#endif
+#ifndef ESPGAMEAPI_SAMPLER_PRIORITY
+#define ESPGAMEAPI_SAMPLER_PRIORITY 2
+#endif
+
+// Fixed capacities of the game-state lists (entries past them are dropped
+// with a warning) and the longest building UID kept
+#ifndef ESPGAMEAPI_MAX_PRODUCTION
+#define ESPGAMEAPI_MAX_PRODUCTION 32
+#endif
+#ifndef ESPGAMEAPI_MAX_CONSUMPTION
+#define ESPGAMEAPI_MAX_CONSUMPTION 32
+#endif
+#ifndef ESPGAMEAPI_MAX_RANGES
+#define ESPGAMEAPI_MAX_RANGES 32
+#endif
+#ifndef ESPGAMEAPI_MAX_BUILDINGS
+#define ESPGAMEAPI_MAX_BUILDINGS 16
+#endif
+#ifndef ESPGAMEAPI_UID_LEN
+#define ESPGAMEAPI_UID_LEN 32
+#endif
+// Largest compact post_vals index reply kept for the loop task
+#ifndef ESPGAMEAPI_INDEX_REPLY_LEN
+#define ESPGAMEAPI_INDEX_REPLY_LEN (1 + ESPGAMEAPI_MAX_BUILDINGS * (2 + ESPGAMEAPI_UID_LEN))
+#endif
+
+// Poll decoders per server, shared by the board and its virtual boards: one
+// is held from enqueueing a poll or tick until its completion, so this caps
+// how many of them are outstanding at once (allocated as needed)
+#ifndef ESPGAMEAPI_POLL_DECODERS
+#define ESPGAMEAPI_POLL_DECODERS (ASYNCREQUEST_MAX_WORKERS + 2)
+#endif
+
+// Combined exchange (/coreapi/tick_binary) section flags, in frame order
+#define TICK_SECTION_POWER       0x01
+#define TICK_SECTION_PLANTS      0x02
+#define TICK_SECTION_CONSUMERS   0x04
+#define TICK_SECTION_BUILDINGS   0x08
+
 // Board types
 enum BoardType { BOARD_SOLAR, BOARD_WIND, BOARD_BATTERY, BOARD_GENERIC };
 
+// Connection pipeline driven by update() after connect()
+enum ConnectionState { CONN_IDLE, CONN_WAIT_WIFI, CONN_LOGIN, CONN_REGISTER, CONN_FIRST_POLL, CONN_ONLINE };
+
 // Structures (unchanged) -------------------------------------------------------
 struct ProductionCoefficient  { uint8_t source_id;   float coefficient;  };
 struct ProductionRange        { uint8_t source_id;   float min_power; float max_power; };
 struct ConsumptionCoefficient { uint8_t building_id; float consumption; };
 struct ConnectedPowerPlant    { uint32_t plant_id;   float set_power;   };
 struct ConnectedConsumer      { uint32_t consumer_id; };
-struct ConnectedBuilding      { String uid;          uint8_t building_type; };
+struct ConnectedBuilding {
+    char    uid[ESPGAMEAPI_UID_LEN + 1];   // NUL-terminated, truncated to fit
+    uint8_t building_type;
+
+    void   setUid(const char* s, size_t len);
+    void   setUid(const char* s) { setUid(s, strlen(s)); }
+    size_t uidLength() const { return strlen(uid); }
+};
+
+// Read-only view of contiguous items, handed out by getters and callbacks.
+// Converts from std::vector and FixedList; valid while the source is.
+template <typename T>
+class ItemView {
+public:
+    ItemView() = default;
+    ItemView(const T* data, size_t size) : ptr(data), len(size) {}
+    template <typename C>
+    ItemView(const C& c) : ptr(c.data()), len(c.size()) {}
+
+    const T* begin() const { return ptr; }
+    const T* end()   const { return ptr + len; }
+    const T* data()  const { return ptr; }
+    size_t   size()  const { return len; }
+    bool     empty() const { return len == 0; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+
+private:
+    const T* ptr = nullptr;
+    size_t   len = 0;
+};
+
+// Inline storage for up to N items - no heap. push_back() refuses (returns
+// false) once full; copies only move the used entries.
+template <typename T, size_t N>
+class FixedList {
+public:
+    FixedList() = default;
+    FixedList(const FixedList& o) { *this = o; }
+    FixedList& operator=(const FixedList& o) {
+        len = o.len;
+        for (size_t i = 0; i < len; i++) items[i] = o.items[i];
+        return *this;
+    }
+    FixedList& operator=(ItemView<T> v) {
+        len = 0;
+        for (const T& item : v) if (!push_back(item)) break;
+        return *this;
+    }
+
+    bool push_back(const T& item) {
+        if (len == N) return false;
+        items[len++] = item;
+        return true;
+    }
+    void clear() { len = 0; }
+
+    T*       begin()       { return items; }
+    T*       end()         { return items + len; }
+    const T* begin() const { return items; }
+    const T* end()   const { return items + len; }
+    T*       data()        { return items; }
+    const T* data()  const { return items; }
+    size_t   size()  const { return len; }
+    bool     empty() const { return len == 0; }
+    bool     full()  const { return len == N; }
+    static constexpr size_t capacity() { return N; }
+    T&       operator[](size_t i)       { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+
+private:
+    T      items[N];
+    size_t len = 0;
+};
+
+using ProductionList  = FixedList<ProductionCoefficient,  ESPGAMEAPI_MAX_PRODUCTION>;
+using ConsumptionList = FixedList<ConsumptionCoefficient, ESPGAMEAPI_MAX_CONSUMPTION>;
+using RangeList       = FixedList<ProductionRange,        ESPGAMEAPI_MAX_RANGES>;
+using BuildingList    = FixedList<ConnectedBuilding,      ESPGAMEAPI_MAX_BUILDINGS>;
+static_assert(ESPGAMEAPI_MAX_PRODUCTION <= 255 && ESPGAMEAPI_MAX_CONSUMPTION <= 255 &&
+              ESPGAMEAPI_MAX_RANGES <= 255, "lists are indexed by uint8_t position");
 
 using PowerCallback       = std::function<float()>;
 using PowerPlantsCallback = std::function<std::vector<ConnectedPowerPlant>()>;
 using ConsumersCallback   = std::function<std::vector<ConnectedConsumer>()>;
-using BuildingsCallback   = std::function<void(const std::vector<ConnectedBuilding>&)>;
+// Allocation-free alternatives: return a view of application-owned storage
+// that stays valid until the calling update() returns
+using PowerPlantsSource   = std::function<ItemView<ConnectedPowerPlant>()>;
+using ConsumersSource     = std::function<ItemView<ConnectedConsumer>()>;
+using BuildingsCallback   = std::function<void(ItemView<ConnectedBuilding>)>;
+using ConnectionStateCallback = std::function<void(ConnectionState)>;
 
 // Async callback types for endpoints
 using AsyncCallback           = std::function<void(bool success, const std::string& error)>;
 using CoefficientsCallback    = std::function<void(bool success, const std::string& error)>;
 using ProductionRangeCallback = std::function<void(bool success, const std::vector<ProductionRange>& ranges, const std::string& error)>;
 using ConsumptionValCallback  = std::function<void(bool success, const std::vector<ConsumptionCoefficient>& coeffs, const std::string& error)>;
+// Copy-free alternatives: a view of the published snapshot list
+using ProductionRangeViewCallback = std::function<void(bool success, ItemView<ProductionRange> ranges, const std::string& error)>;
+using ConsumptionValViewCallback  = std::function<void(bool success, ItemView<ConsumptionCoefficient> coeffs, const std::string& error)>;
+
+// Legacy frame entries, milliwatt values. Plain structs: the wire layout
+// (big-endian, no padding) is their Wire::Layout below, not the memory layout.
+struct PowerDataRequest { int32_t production; int32_t consumption; };
+// post_vals_batch: [version][count u16] then count of these, oldest first;
+// age_ms is how long before the upload the sample was taken
+struct PowerSampleEntry { uint32_t age_ms; int32_t production; int32_t consumption; };
+struct ProductionEntry  { uint8_t source_id; int32_t coefficient; };
+struct ProductionRangeEntry { uint8_t source_id; int32_t min_power; int32_t max_power; };
+struct ConsumptionEntry { uint8_t building_id; int32_t consumption; };
+struct PowerPlantEntry  { uint32_t plant_id;  int32_t set_power;  };
+struct ConsumerEntry    { uint32_t consumer_id; };
+
+namespace Wire {
+template <> struct Layout<PowerDataRequest> : Record<PowerDataRequest,
+    WIRE_FIELD(PowerDataRequest, production), WIRE_FIELD(PowerDataRequest, consumption)> {};
+template <> struct Layout<PowerSampleEntry> : Record<PowerSampleEntry,
+    WIRE_FIELD(PowerSampleEntry, age_ms), WIRE_FIELD(PowerSampleEntry, production),
+    WIRE_FIELD(PowerSampleEntry, consumption)> {};
+template <> struct Layout<ProductionEntry> : Record<ProductionEntry,
+    WIRE_FIELD(ProductionEntry, source_id), WIRE_FIELD(ProductionEntry, coefficient)> {};
+template <> struct Layout<ProductionRangeEntry> : Record<ProductionRangeEntry,
+    WIRE_FIELD(ProductionRangeEntry, source_id), WIRE_FIELD(ProductionRangeEntry, min_power),
+    WIRE_FIELD(ProductionRangeEntry, max_power)> {};
+template <> struct Layout<ConsumptionEntry> : Record<ConsumptionEntry,
+    WIRE_FIELD(ConsumptionEntry, building_id), WIRE_FIELD(ConsumptionEntry, consumption)> {};
+template <> struct Layout<PowerPlantEntry> : Record<PowerPlantEntry,
+    WIRE_FIELD(PowerPlantEntry, plant_id), WIRE_FIELD(PowerPlantEntry, set_power)> {};
+template <> struct Layout<ConsumerEntry> : Record<ConsumerEntry, WIRE_FIELD(ConsumerEntry, consumer_id)> {};
+}  // namespace Wire
 
-struct __attribute__((packed)) PowerDataRequest { int32_t production; int32_t consumption; };
-struct __attribute__((packed)) ProductionEntry  { uint8_t source_id; int32_t coefficient; };
-struct __attribute__((packed)) ProductionRangeEntry { uint8_t source_id; int32_t min_power; int32_t max_power; };
-struct __attribute__((packed)) ConsumptionEntry { uint8_t building_id; int32_t consumption; };
-struct __attribute__((packed)) PowerPlantEntry  { uint32_t plant_id;  int32_t set_power;  };
-struct __attribute__((packed)) ConsumerEntry    { uint32_t consumer_id; };
+// The frame sizes the server expects
+static_assert(Wire::Layout<PowerDataRequest>::size == 8 && Wire::Layout<PowerSampleEntry>::size == 12 &&
+              Wire::Layout<ProductionEntry>::size == 5 && Wire::Layout<ProductionRangeEntry>::size == 9 &&
+              Wire::Layout<ConsumptionEntry>::size == 5 && Wire::Layout<PowerPlantEntry>::size == 8 &&
+              Wire::Layout<ConsumerEntry>::size == 4, "legacy entry sizes");
+
+// Game state published by the network side. Two of these are double
+// buffered: parsers fill the back buffer and flip it in atomically, so a
+// snapshot handed to a reader is never modified before the next-but-one
+// publication (see ESPGameAPI::snapshotValid()).
+struct GameSnapshot {
+    uint32_t generation = 0;
+    bool     gameActive = false;
+    ProductionList  production;
+    ConsumptionList consumption;
+    RangeList       ranges;
+
+    // O(1) lookup by id (nullptr if absent; first entry wins on duplicates)
+    const ProductionCoefficient*  findProduction (uint8_t source_id)   const { return at(production,  productionIndex[source_id]); }
+    const ConsumptionCoefficient* findConsumption(uint8_t building_id) const { return at(consumption, consumptionIndex[building_id]); }
+    const ProductionRange*        findRange      (uint8_t source_id)   const { return at(ranges,      rangeIndex[source_id]); }
+    // Rebuilds the id tables from the vectors (done once per publication)
+    void reindex();
+
+private:
+    // position + 1 in the vector, 0 = no entry for that id
+    uint8_t productionIndex[256] = {};
+    uint8_t consumptionIndex[256] = {};
+    uint8_t rangeIndex[256] = {};
+
+    template <typename L>
+    static auto at(const L& list, uint8_t slot) -> decltype(&list[0]) { return slot ? &list[slot - 1] : nullptr; }
+};
+
+// Fixed-size store-and-forward buffer of power samples (mW). When full the
+// oldest sample is overwritten. Every sample has an absolute sequence number
+// so an upload can release exactly what it sent, even if newer samples
+// arrived meanwhile. Safe to use from the loop task and worker tasks.
+class PowerSampleRing {
+public:
+    struct Sample { uint32_t t_ms; int32_t production; int32_t consumption; };
+
+    void     push(uint32_t t_ms, int32_t production, int32_t consumption);
+    size_t   size() const;
+    // Copies up to max of the oldest samples; *firstSeq = sequence of out[0]
+    size_t   peek(Sample* out, size_t max, uint32_t* firstSeq) const;
+    void     releaseBefore(uint32_t seq);   // drop samples older than seq
+    uint32_t dropped() const { return overwritten; }
+
+private:
+    Sample   buf[ESPGAMEAPI_SAMPLE_BUFFER_LEN];
+    uint32_t head = 0, tail = 0;            // sequence of the oldest / next sample
+    uint32_t overwritten = 0;
+    mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+};
+
+// Spacing of one periodic request under adaptive scheduling: doubles per
+// backoff() up to ESPGAMEAPI_BACKOFF_MAX_MS, halves for a few requests after
+// speedUp(), and takes a server hint once. Every gap gets a random spread so
+// boards started together drift apart.
+class AdaptiveInterval {
+public:
+    void backoff() { if (level < 16) level++; boost = 0; }
+    void settle()  { level = 0; }
+    void speedUp() { level = 0; boost = ESPGAMEAPI_FAST_POLLS; }
+    void hint(uint32_t ms) { hintMs = ms; }
+    void reset()   { level = 0; boost = 0; hintMs = 0; }
+    // Gap before the next request, given the configured interval
+    uint32_t next(uint32_t base);
+    static uint32_t jitter(uint32_t ms);
+
+private:
+    uint8_t  level = 0, boost = 0;
+    uint32_t hintMs = 0;
+};
+
+// Running statistics for production/consumption sampled faster than the
+// network interval. O(1) memory: min/max, a sample count and the energy
+// integral (zero-order hold between samples), so the reported mean is
+// time-weighted even when samples are irregular.
+class PowerAggregator {
+public:
+    struct Channel {
+        float  min, max;
+        float  mean;        // W, time-weighted over the window
+        double energyJ;     // integrated over the window
+    };
+    struct Window {
+        uint32_t count;     // samples in the window
+        uint32_t durationMs;
+        Channel  production, consumption;
+    };
+
+    void add(float production, float consumption, uint32_t t_ms);
+    // Closes the window at t_ms and starts the next one; false if it was empty
+    bool take(Window& out, uint32_t t_ms);
+
+private:
+    struct Acc { float min, max, last; double energyJ; };
+    Acc prod = {}, cons = {};
+    uint32_t count = 0, startMs = 0, lastMs = 0;
+    mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    static void hold(Acc& a, uint32_t dtMs) { a.energyJ += a.last * (dtMs / 1000.0); }
+    static void close(const Acc& a, Channel& c, uint32_t durationMs);
+};
+
+// Incremental poll_binary decoder --------------------------------------------
+// Consumes the body as it comes off the socket into fixed-capacity lists:
+//   [prodCount][(id, i32 mW) * n][consCount][(id, i32 mW) * n]
+//   [bldCount][(uidLen, uid, type) * n]
+// An empty body means the game is paused. Results are only valid once end()
+// reported a complete frame.
+class PollDecoder : public AsyncRequest::BodySink {
+public:
+    enum Result { PENDING, PAUSED, COMPLETE, MALFORMED };
+
+    ProductionList  production;
+    ConsumptionList consumption;
+    BuildingList    buildings;
+    uint8_t         dropped = 0;   // entries past a list's capacity
+
+    void begin(int status) override;
+    bool write(const uint8_t* data, size_t len) override;
+    void end(bool complete) override;
+
+    void decode(const uint8_t* data, size_t len) { begin(200); write(data, len); end(true); }
+    Result result() const { return res; }
+    const char* error() const { return err; }
+
+private:
+    enum State { S_PROD_COUNT, S_PROD_ENTRY, S_CONS_COUNT, S_CONS_ENTRY,
+                 S_BLD_COUNT, S_BLD_UIDLEN, S_BLD_UID, S_BLD_TYPE, S_DONE, S_ERROR };
+    State state = S_PROD_COUNT;
+    Result res = PENDING;
+    const char* err = "";
+    size_t total = 0;
+    uint8_t remaining = 0;       // entries left in the current section
+    uint8_t entry[Wire::Layout<ProductionEntry>::size];   // consumption entries are the same size
+    uint8_t entryPos = 0;
+    uint8_t uidLen = 0, uidPos = 0;
+    char uid[ESPGAMEAPI_UID_LEN + 1];   // longer UIDs are truncated
+
+    void fail(const char* why) { state = S_ERROR; err = why; }
+};
 
 // ───────────────────────────────────────────────────────────────────────────────
 class ESPGameAPI {
@@ -69,47 +449,274 @@ private:
     BoardType boardType;
     bool isLoggedIn, isRegistered;
 
+    // connection pipeline (see advanceConnection())
+    volatile ConnectionState connState;
+    bool autoConnect;                    // connect() called / re-login allowed
+    volatile bool authInFlight;          // prewarm, login or register outstanding
+    bool linkWarm;                       // prewarm issued since the link came up
+    unsigned long connectRetryAt;
+    ConnectionStateCallback connectionStateCallback;
+    // Login result from the worker: pendingToken is written before tokenReady
+    // is set, token/authHeaders only change on the loop task (applyLogin())
+    String pendingToken;
+    bool tokenReady;
+    // Session changes from the workers, applied by the loop task
+    // (applySession()): pendingProtocol is written before SESSION_REGISTERED
+    enum : uint8_t { SESSION_REGISTERED = 1, SESSION_EXPIRED = 2, SESSION_ANSWERED = 4 };
+    uint8_t sessionEvents;
+    uint8_t pendingProtocol;             // version the register reply advertised
+
     unsigned long lastUpdateTime, updateInterval;
     unsigned long lastPollTime,   pollInterval;
+    unsigned long updateGap, pollGap;   // current spacing (adaptive or the interval)
+
+    // adaptive scheduling (setAdaptiveIntervals())
+    bool adaptiveIntervals;
+    AdaptiveInterval pollSchedule, postSchedule;
+    bool holdOff;                        // server asked for a pause (429/503 Retry-After)
+    unsigned long holdOffUntil;
+    // The schedules and hold-off are the loop task's: workers only record
+    // each answer's outcome, applyScheduleOutcomes() applies them in order
+    // (a full list drops the newest)
+    enum : uint8_t { SCHED_POLL, SCHED_POST };
+    enum : uint8_t { STEP_SETTLE, STEP_BACKOFF, STEP_SPEED_UP };
+    struct ScheduleOutcome { uint8_t schedule, step; bool holdOff; int16_t status; uint32_t retryMs; };
+    FixedList<ScheduleOutcome, 8> scheduleOutcomes;   // only under scheduleLock
+    portMUX_TYPE scheduleLock = portMUX_INITIALIZER_UNLOCKED;
+    bool wasGameActive;
 
     PowerCallback       productionCallback;
     PowerCallback       consumptionCallback;
     PowerPlantsCallback powerPlantsCallback;
     ConsumersCallback   consumersCallback;
+    PowerPlantsSource   powerPlantsSource;    // preferred over the callbacks when set
+    ConsumersSource     consumersSource;
     BuildingsCallback   buildingsCallback;
 
-    std::vector<ProductionCoefficient>  productionCoefficients;
-    std::vector<ProductionRange>        productionRanges;
-    std::vector<ConsumptionCoefficient> consumptionCoefficients;
-    std::vector<ConnectedBuilding>      connectedBuildings;
-    bool gameActive;
+    BuildingList connectedBuildings;
 
     volatile bool coeffsUpdated;                 // set from async callback
     bool requestPollInFlight, requestPostInFlight;
     bool requestRangesInFlight;  // Add tracking for production ranges requests
+    bool combinedExchange;       // opt-in single round trip per tick
+    bool combinedSupported;      // cleared when the server lacks tick_binary
+
+    // last acknowledged device reports (only changes are re-sent). A report
+    // waits in sent* under a sequence number; the worker only records which
+    // sequence was acknowledged and the loop task applies it.
+    std::vector<ConnectedPowerPlant> lastReportedPlants, sentPlants;
+    std::vector<ConnectedConsumer>   lastReportedConsumers, sentConsumers;
+    uint8_t plantsSeq, consumersSeq;
+    volatile uint8_t plantsAcked, consumersAcked;
+    bool plantsPending, consumersPending;
+    bool plantsReported, consumersReported;
+    volatile bool plantsChanged;  // notifyPlantsChanged(): report on the next update()
+    unsigned long lastPlantsAckTime, lastConsumersAckTime;
+    unsigned long reportRefreshInterval;
+    float reportDeadband;        // W; set_power moves within this are ignored
+
+    // Version of the last parsed poll response. Written by the workers,
+    // read by the loop task for If-None-Match: only under etagLock.
+    char pollETag[ESPGAMEAPI_ETAG_LEN + 1];
+    portMUX_TYPE etagLock = portMUX_INITIALIZER_UNLOCKED;
+    bool pushMode;               // keep a long-poll outstanding instead of timed polls
+    bool pollImmediately;        // re-arm the long-poll without waiting pollInterval
+    bool pipelining;             // reports/post_vals may share one round trip
+
+    // local sampling between the power callbacks and the network interval
+    PowerAggregator aggregator;
+    PowerAggregator::Window lastWindow;
+    unsigned long samplingInterval;     // 0 = call the callbacks once per submission
+    unsigned long lastSampleTime;
+    TaskHandle_t  samplerTask;
+    static void samplerTaskMain(void*);
+
+    // store-and-forward for power samples
+    PowerSampleRing sampleRing;
+    PowerSampleRing::Sample postedSamples[8];   // by sendBinary tag, re-buffered on failure
+    uint8_t postedNext;
+    bool    backlogInFlight;
+    uint32_t backlogEnd;                        // sequence after the last uploaded sample
+
+    // compact protocol: power deltas against the last acknowledged values,
+    // buildings by server-assigned index
+    bool    compactProtocol;             // requested by the application
+    uint8_t serverProtocol;              // highest version advertised at register
+    struct { int32_t production, consumption; uint8_t seq; bool valid; } powerBase;
+    uint8_t powerSeq;                    // 4-bit frame sequence
+    uint8_t postedSeqs[8];               // by sendBinary tag, LEGACY_FRAME if not compact
+    struct IndexedBuilding { char uid[ESPGAMEAPI_UID_LEN + 1]; uint8_t index; };
+    FixedList<IndexedBuilding, ESPGAMEAPI_MAX_BUILDINGS> buildingIndex;   // uid -> server index
+    // The state above is the loop task's. Workers only record acknowledged
+    // tags, a 409 and the last index reply; applyCompactAcks() applies them.
+    volatile uint8_t powerAckedTags;     // bit per sendBinary tag
+    volatile bool    powerRejected;      // 409: base unknown, key frame next
+    uint8_t indexReply[ESPGAMEAPI_INDEX_REPLY_LEN];
+    size_t  indexReplyLen;               // 0 = none pending, only under compactLock
+    portMUX_TYPE compactLock = portMUX_INITIALIZER_UNLOCKED;
+    static const char* pollResponseHeaders[];
+
+    // endpoint ids (URL table index and coalescing keys)
+    enum Endpoint : uint8_t {
+        EP_NONE = 0, EP_POST_VALS, EP_PROD_CONNECTED, EP_CONS_CONNECTED,
+        EP_POST_BUILDINGS,  // post_vals with buildings (own log text only)
+        EP_LOGIN, EP_REGISTER, EP_POLL, EP_POLL_WAIT, EP_TICK, EP_PROD_VALS, EP_CONS_VALS,
+        EP_METRICS, EP_POST_BATCH,
+        EP_COUNT
+    };
+
+    // preformatted request pieces, reused by every request
+    static_assert(EP_COUNT <= ASYNCREQUEST_METRIC_SLOTS, "one metrics slot per endpoint");
+    static const char* const endpointPaths[EP_COUNT];
+    AsyncRequest::Headers authHeaders, binaryHeaders;
+    // scratch shared by all instances (loop task only)
+    static AsyncRequest::Headers condHeaders;         // auth + If-None-Match
+    static std::vector<uint8_t>  txBuf;               // payload
+    static std::vector<ConnectedPowerPlant> plantsScratch;      // from the vector callbacks
+    static std::vector<ConnectedConsumer>   consumersScratch;
+
+    // Per server: double-buffered game state (written by worker tasks, read
+    // lock-free), endpoint URLs and poll decoders. A board owns one; its
+    // virtual boards point at the same one.
+    struct Shared {
+        GameSnapshot snapshots[2];
+        volatile uint8_t  frontSnapshot = 0;
+        volatile uint32_t writeGeneration = 0;   // generation currently being written
+        SemaphoreHandle_t publishMutex;          // serializes writers only
+        std::string urls[EP_COUNT];
+        uint32_t     originHash = 0;             // AsyncRequest::originHash() of every url
+        PollDecoder* decoders[ESPGAMEAPI_POLL_DECODERS] = {};
+        bool         busy[ESPGAMEAPI_POLL_DECODERS] = {};
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+        explicit Shared(const String& baseUrl);
+        ~Shared();
+        PollDecoder* claimDecoder();             // loop task; NULL when all are held
+        void releaseDecoder(PollDecoder*);       // any task
+
+        // Releases a claimed decoder when the completion that held it returns
+        struct Lease {
+            Shared* shared; PollDecoder* decoder;
+            ~Lease() { shared->releaseDecoder(decoder); }
+        };
+    };
+    Shared* shared;
+    bool    ownsShared;
+    ESPGameAPI(const String&, const String&, BoardType, unsigned long, unsigned long, Shared*);
 
     // ---------- helpers ----------
-    uint32_t hostToNetworkLong     (uint32_t);
-    uint64_t hostToNetworkLongLong (uint64_t);
-    uint32_t networkToHostLong     (uint32_t);
-    uint64_t networkToHostLongLong (uint64_t);
-    uint16_t networkToHostShort    (uint16_t);
     String   boardTypeToString(BoardType) const;
+    AsyncRequest::Options requestOptions(AsyncRequest::Priority, Endpoint, uint8_t coalesceEndpoint = EP_NONE) const;
+    AsyncRequest::Options hedgedOptions(Endpoint) const;
+    void rebuildAuthHeaders();
+    // tag: index into postedSamples for post_vals, report sequence for
+    // *_connected, NO_SAMPLE otherwise
+    enum : uint8_t { NO_SAMPLE = 0xFF, LEGACY_FRAME = 0xFF };
+    void sendBinary  (Endpoint, AsyncRequest::Priority, uint8_t coalesceEndpoint, AsyncCallback, uint8_t tag = NO_SAMPLE);
+    void onBinaryDone(Endpoint, uint8_t tag, esp_err_t, int status, const uint8_t* body, size_t len, const AsyncCallback&);
+    uint8_t stageSample(float production, float consumption);
+    // changed: the answer published different coefficients (speeds polling up)
+    void    adaptPollSchedule(esp_err_t err, int status, const AsyncRequest::Headers& respHeaders, bool changed = false);
+    void    adaptPostSchedule(esp_err_t err, int status);
+    void    recordOutcome(const ScheduleOutcome&);
+    void    applyScheduleOutcomes();
+    unsigned long nextPollGap()   { return adaptiveIntervals ? pollSchedule.next(pollInterval)   : pollInterval; }
+    unsigned long nextUpdateGap() { return adaptiveIntervals ? postSchedule.next(updateInterval) : updateInterval; }
+    void    samplePower(unsigned long now);
+    bool    takePowerValues(float& production, float& consumption);
+    void    bufferSample(float production, float consumption);
+    void    uploadBacklog();
+
+    // payload builders (shared by per-endpoint and combined requests)
+    // (the section builders switch to the compact encoding once negotiated)
+    void appendU32        (std::vector<uint8_t>& data, uint32_t v) { Wire::append(data, v); }
+    void appendVarint     (std::vector<uint8_t>&, uint32_t);
+    void appendZigZag     (std::vector<uint8_t>&, int32_t);
+    void startFrame       (std::vector<uint8_t>&);
+    void appendPowerData  (std::vector<uint8_t>&, uint8_t tag);   // staged sample
+    void appendPowerPlants(std::vector<uint8_t>&, ItemView<ConnectedPowerPlant>);
+    void appendConsumers  (std::vector<uint8_t>&, ItemView<ConnectedConsumer>);
+    void appendBuildings  (std::vector<uint8_t>&, ItemView<ConnectedBuilding>);
+    void appendPercentiles(std::vector<uint8_t>&, const AsyncRequest::Histogram&);
+    bool useCompact() const { return compactProtocol && serverProtocol >= PROTOCOL_VERSION_COMPACT; }
+    void ackPowerFrame(uint8_t tag);
+    void storeBuildingIndexes(const uint8_t* body, size_t len);
+    void recordPowerAck(uint8_t tag) { __atomic_fetch_or(&powerAckedTags, 1u << tag, __ATOMIC_RELEASE); }
+    void recordIndexReply(const uint8_t* body, size_t len);
+    void applyCompactAcks();
+    void resetCompactState();
+
+    // dirty tracking for prod_connected / cons_connected
+    bool hasPlants()    const { return powerPlantsSource || powerPlantsCallback; }
+    bool hasConsumers() const { return consumersSource || consumersCallback; }
+    ItemView<ConnectedPowerPlant> currentPlants();      // from the source or callback
+    ItemView<ConnectedConsumer>   currentConsumers();
+    bool plantsReportDue   (ItemView<ConnectedPowerPlant>, unsigned long now);
+    bool consumersReportDue(ItemView<ConnectedConsumer>,   unsigned long now);
+    uint8_t stagePlantsReport   (ItemView<ConnectedPowerPlant>);   // sequence for the ack
+    uint8_t stageConsumersReport(ItemView<ConnectedConsumer>);
+    void applyReportAcks(unsigned long now);
+    void reportPlantsIfChanged   (unsigned long now);
+    void reportConsumersIfChanged(unsigned long now);
 
     // parsing helpers
-    bool parseProductionRanges       (const uint8_t*, size_t);
-    bool parseConsumptionCoefficients(const uint8_t*, size_t);
+    static bool rangesFrameValid     (const uint8_t*, size_t);
+    static bool consumptionFrameValid(const uint8_t*, size_t);
+    bool parseProductionRanges       (const uint8_t*, size_t, RangeList&);
+    bool parseConsumptionCoefficients(const uint8_t*, size_t, ConsumptionList&);
+
+    // snapshot publication (writer side)
+    GameSnapshot& beginPublish();        // back buffer, pre-filled from the front
+    void          endPublish();
     void parsePollResponse(const uint8_t* data, size_t len);
+    bool applyPollResult(PollDecoder&);   // true if the coefficients changed
+    void storePollETag(const AsyncRequest::Headers&);
+    void clearPollETag();
+    void addPollETag(AsyncRequest::Headers&);
+
+    // connection pipeline
+    void startLogin();
+    void startRegister();
+    void onLoginDone   (esp_err_t, int status, const uint8_t* body, size_t len);
+    void applyLogin();
+    void onRegisterDone(esp_err_t, int status, const uint8_t* body, size_t len);
+    void onAuthExpired();
+    void onPollAnswered(int status);
+    void postSession(uint8_t event) { __atomic_fetch_or(&sessionEvents, event, __ATOMIC_RELEASE); }
+    void applySession();
+    void expireSession();
+    void setConnectionState(ConnectionState);
+    void advanceConnection(unsigned long now);
+    bool waitForAuth();
+    void startPoll(bool hold, CoefficientsCallback callback);
 
 public:
     ESPGameAPI(const String&, const String&, BoardType,
                unsigned long updateIntervalMs = 3000,
                unsigned long pollIntervalMs   = 5000);
+    // Virtual board on `server`'s server: its own login, token, registration
+    // and schedule, but the game state, URLs and poll decoders of `server`
+    // (which must outlive it). All instances share the AsyncRequest workers
+    // and connections, so one device can act as many boards.
+    ESPGameAPI(ESPGameAPI& server, const String& name, BoardType,
+               unsigned long updateIntervalMs = 3000,
+               unsigned long pollIntervalMs   = 5000);
+    ~ESPGameAPI();
+    ESPGameAPI(const ESPGameAPI&) = delete;
+    ESPGameAPI& operator=(const ESPGameAPI&) = delete;
 
     // Initialize certificate bundle (call in setup())
     static void initCertificateBundle();
 
-    // authentication (synchronous)
+    // authentication (non-blocking): WiFi → login → register → first poll,
+    // advanced by update(); a 401 later on logs in again automatically
+    void connect(const String& user, const String& pass);
+    ConnectionState getConnectionState() const { return connState; }
+    static const char* connectionStateName(ConnectionState);
+    // Called on every state change (from the task that completed the request)
+    void setConnectionStateCallback(ConnectionStateCallback cb) { connectionStateCallback = cb; }
+
+    // authentication (synchronous wrappers, wait up to ESPGAMEAPI_AUTH_TIMEOUT_MS)
     bool login(const String&, const String&);
     bool registerBoard();
     bool isGameRegistered() const { return isRegistered; }
@@ -120,10 +727,13 @@ public:
     void setConsumptionCallback  (PowerCallback cb)       { consumptionCallback  = cb; }
     void setPowerPlantsCallback  (PowerPlantsCallback cb) { powerPlantsCallback  = cb; }
     void setConsumersCallback    (ConsumersCallback cb)   { consumersCallback    = cb; }
+    void setPowerPlantsSource    (PowerPlantsSource src)  { powerPlantsSource    = src; }
+    void setConsumersSource      (ConsumersSource src)    { consumersSource      = src; }
     void setBuildingsCallback    (BuildingsCallback cb)   { buildingsCallback    = cb; }
     
     // Set connected buildings for sending with power data
-    void setConnectedBuildings(const std::vector<ConnectedBuilding>& buildings) {
+    // (at most ESPGAMEAPI_MAX_BUILDINGS are kept)
+    void setConnectedBuildings(ItemView<ConnectedBuilding> buildings) {
         connectedBuildings = buildings;
     }
 
@@ -134,26 +744,118 @@ public:
     void pollCoefficients(CoefficientsCallback callback = nullptr);
     void getProductionRanges(ProductionRangeCallback callback);
     void getConsumptionValues(ConsumptionValCallback callback);
+    void requestProductionRanges(ProductionRangeViewCallback callback);   // no vector copy
+    void requestConsumptionValues(ConsumptionValViewCallback callback);
     void submitPowerData(float production, float consumption, AsyncCallback callback = nullptr);
-    void submitPowerDataWithBuildings(float production, float consumption, const std::vector<ConnectedBuilding>& buildings, AsyncCallback callback = nullptr);
-    void reportConnectedPowerPlants(const std::vector<ConnectedPowerPlant>&, AsyncCallback callback = nullptr);
-    void reportConnectedConsumers(const std::vector<ConnectedConsumer>&, AsyncCallback callback = nullptr);
+    void submitPowerDataWithBuildings(float production, float consumption, ItemView<ConnectedBuilding> buildings, AsyncCallback callback = nullptr);
+    void reportConnectedPowerPlants(ItemView<ConnectedPowerPlant>, AsyncCallback callback = nullptr);
+    void reportConnectedConsumers(ItemView<ConnectedConsumer>, AsyncCallback callback = nullptr);
 
-    // getters
-    const std::vector<ProductionCoefficient>&  getProductionCoefficients()  const { return productionCoefficients;  }
-    const std::vector<ProductionRange>&        getProductionRanges()        const { return productionRanges;       }
-    const std::vector<ConsumptionCoefficient>& getConsumptionCoefficients() const { return consumptionCoefficients; }
-    bool  isGameActive() const { return gameActive; }
+    // Combined exchange: power values, plants, consumers and buildings in one
+    // POST, answered with a poll_binary style body. With includeReports=false
+    // it acts as a plain poll.
+    void exchangeTick(bool includeReports, AsyncCallback callback = nullptr);
+
+    // Request metrics: per-endpoint latency histograms (p50/p95/p99) plus
+    // drop, connection and byte counters. Metrics is ~4 KB - keep it static.
+    static void getMetrics(AsyncRequest::Metrics& out) { AsyncRequest::metrics(out); }
+    static void resetMetrics() { AsyncRequest::resetMetrics(); }
+    static const char* metricsSlotName(uint8_t slot);   // endpoint path of a Metrics::slot[] index
+    // Uploads a compact binary summary to /coreapi/metrics_binary
+    void reportMetrics(AsyncCallback callback = nullptr);
+
+    // Local sampling: call the power callbacks every `ms` and submit the
+    // time-weighted mean of each network interval instead of one instant
+    // reading (0 = off). By default sampling runs inside update(), so it is
+    // only as regular as loop(). ownTask = true samples from a dedicated
+    // task; the callbacks then run on that task and must be thread-safe.
+    void setSamplingInterval(unsigned long ms, bool ownTask = false);
+    // Statistics of the last submitted window (min/max/mean/energy)
+    const PowerAggregator::Window& getLastPowerWindow() const { return lastWindow; }
+
+    // Store-and-forward: samples taken while offline (or whose post_vals
+    // failed) wait here and are uploaded via post_vals_batch once online.
+    size_t   bufferedSampleCount()  const { return sampleRing.size(); }
+    uint32_t droppedSampleCount()   const { return sampleRing.dropped(); }
+
+    // getters - views into the current snapshot (see snapshot())
+    ItemView<ProductionCoefficient>  getProductionCoefficients()  const { return snapshot().production;  }
+    ItemView<ProductionRange>        getProductionRanges()        const { return snapshot().ranges;      }
+    ItemView<ConsumptionCoefficient> getConsumptionCoefficients() const { return snapshot().consumption; }
+    bool  isGameActive() const { return snapshot().gameActive; }
+    // O(1) lookups by id into the current snapshot; nullptr if the id is absent
+    const ProductionCoefficient*  getProductionCoefficient(uint8_t source_id)   const { return snapshot().findProduction(source_id); }
+    const ProductionRange*        getRange                (uint8_t source_id)   const { return snapshot().findRange(source_id); }
+    const ConsumptionCoefficient* getConsumption          (uint8_t building_id) const { return snapshot().findConsumption(building_id); }
+
+    // Consistent, lock-free view of the latest published game state. Safe to
+    // read from any task; it stays untouched until two more publications
+    // happen, which snapshotValid() detects after the fact.
+    // Virtual boards read their server's snapshot.
+    const GameSnapshot& snapshot() const {
+        return shared->snapshots[__atomic_load_n(&shared->frontSnapshot, __ATOMIC_ACQUIRE)];
+    }
+    uint32_t snapshotGeneration() const { return snapshot().generation; }
+    bool snapshotValid(const GameSnapshot& s) const {
+        return __atomic_load_n(&shared->writeGeneration, __ATOMIC_ACQUIRE) - s.generation < 2;
+    }
+    // Copies the latest snapshot, retrying if a writer overtook the copy
+    void readSnapshot(GameSnapshot& out) const;
 
     // config
-    void setUpdateInterval(unsigned long ms) { updateInterval = ms; }
-    void setPollInterval  (unsigned long ms) { pollInterval   = ms; }
+    void setUpdateInterval(unsigned long ms) { updateInterval = updateGap = ms; }
+    void setPollInterval  (unsigned long ms) { pollInterval   = pollGap   = ms; }
+    // Adaptive intervals: back off exponentially (with jitter) on errors,
+    // 429/503 and while the game is paused, poll faster right after a
+    // coefficient change, honour Retry-After, and spread the first post_vals
+    // of a game over one updateInterval. The set intervals become the base.
+    void setAdaptiveIntervals(bool enable);
+    bool isAdaptiveIntervals() const { return adaptiveIntervals; }
+    unsigned long getCurrentPollGap()   const { return pollGap; }
+    unsigned long getCurrentUpdateGap() const { return updateGap; }
+    // Opt-in: let update() use exchangeTick() instead of up to four requests.
+    // Falls back to the per-endpoint requests if the server rejects it.
+    void setCombinedExchange(bool enable) { combinedExchange = enable; combinedSupported = true; }
+    bool isCombinedExchangeActive() const { return combinedExchange && combinedSupported; }
+    // Device reports from update() are only sent when the plant/consumer set
+    // changes, a set_power moves by more than the deadband, or the refresh
+    // interval expires (0 = always send).
+    void setReportDeadband       (float watts)      { reportDeadband = watts; }
+    void setReportRefreshInterval(unsigned long ms) { reportRefreshInterval = ms; }
+    void forceDeviceReport() { plantsReported = false; consumersReported = false; }
+    // Any task may flag that set_power moved meaningfully; update() then
+    // re-reads powerPlantsCallback and reports without waiting for the
+    // update interval (per-endpoint mode; the combined exchange sends it
+    // with its next tick).
+    void notifyPlantsChanged() { plantsChanged = true; }
+    // Push mode: update() keeps one long-poll (poll_binary?wait=N) open so
+    // coefficient changes arrive as soon as the server publishes them.
+    void setPushMode(bool enable) { pushMode = enable; pollImmediately = enable; }
+    bool isPushMode() const { return pushMode; }
+    // Opt-in HTTP pipelining: the reports and post_vals one update() queues
+    // are written back-to-back on one connection and answered in one round
+    // trip. If the server closes early, the requests it may have seen fail
+    // (post_vals samples go back to the store-and-forward ring).
+    void setPipelining(bool enable) { pipelining = enable; }
+    bool isPipelining() const { return pipelining; }
+    // Opt-in compact frames (PROTOCOL_VERSION_COMPACT): zig-zag varints, power
+    // as deltas against the last acknowledged sample, buildings by index.
+    // Only used once the server advertises version 2 in its register reply.
+    void setCompactProtocol(bool enable) { compactProtocol = enable; resetCompactState(); }
+    bool isCompactProtocolActive() const { return useCompact(); }
+    // Deferred callbacks: every AsyncCallback, coefficient/range callback and
+    // internal response handler runs from update() on the loop() task instead
+    // of on an HTTP worker. Applies to all AsyncRequest users.
+    void setDeferredCallbacks(bool enable) { AsyncRequest::setDeferredCallbacks(enable); }
+    bool isDeferredCallbacks() const { return AsyncRequest::deferredCallbacks(); }
 
     // network
     bool isConnected() const { return WiFi.status() == WL_CONNECTED && isLoggedIn && isRegistered; }
 
     // debug helpers (only emit if ESPGAMEAPI_ENABLE_SERIAL defined)
     void printStatus() const;
+    void printMetrics() const;
+    void printTaskStatus() const;   // cores, priorities and stack use; call from loop()
     void printCoefficients() const;
 };
 
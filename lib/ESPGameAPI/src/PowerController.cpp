@@ -0,0 +1,111 @@
+#include "PowerController.h"
+#include <math.h>
+
+PowerController::PowerController(ESPGameAPI& api) : api(api) {
+    // Read on the loop task into a buffer the controller task never touches
+    api.setPowerPlantsSource([this]() {
+        return ItemView<ConnectedPowerPlant>(reported, readSetpoints(reported, ESPGAMEAPI_MAX_PLANTS));
+    });
+    // Ramp steps below the deadband would otherwise each be re-reported
+    api.setReportDeadband(deadband);
+}
+
+PowerController::~PowerController() {
+    end();
+    api.setPowerPlantsSource(nullptr);
+}
+
+bool PowerController::addPlant(uint32_t plant_id, uint8_t source_id, float share) {
+    Plant p = { plant_id, source_id, share, 0.0f, 0.0f };
+    portENTER_CRITICAL(&lock);
+    bool added = plants.push_back(p);
+    portEXIT_CRITICAL(&lock);
+    return added;
+}
+
+bool PowerController::begin(uint32_t period, BaseType_t core) {
+    if (task) return true;
+    periodMs = period ? period : 1;
+    lastStep = millis();
+    return xTaskCreatePinnedToCore(taskMain, "pwrCtl", ESPGAMEAPI_CONTROLLER_STACK, this,
+                                   ESPGAMEAPI_CONTROLLER_PRIORITY, &task, core) == pdPASS;
+}
+
+void PowerController::end() {
+    if (!task) return;
+    vTaskDelete(task);
+    task = NULL;
+}
+
+void PowerController::taskMain(void* arg) {
+    PowerController* self = static_cast<PowerController*>(arg);
+    TickType_t wake = xTaskGetTickCount();
+    for (;;) {
+        self->step(millis());
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(self->periodMs));
+    }
+}
+
+float PowerController::target(const Plant& p, const GameSnapshot& s) const {
+    if (!s.gameActive) return 0.0f;
+    const ProductionCoefficient* c = s.findProduction(p.source_id);
+    if (!c) return p.setpoint;
+    float watts = c->coefficient * p.share;
+    if (const ProductionRange* r = s.findRange(p.source_id)) {
+        if (watts < r->min_power) watts = r->min_power;
+        if (watts > r->max_power) watts = r->max_power;
+    }
+    return watts;
+}
+
+void PowerController::step(uint32_t now_ms) {
+    // Targets from a consistent snapshot; a torn read just waits for the next step
+    float targets[ESPGAMEAPI_MAX_PLANTS];
+    const GameSnapshot& s = api.snapshot();
+    for (size_t i = 0; i < plants.size(); i++) targets[i] = target(plants[i], s);
+    if (!api.snapshotValid(s)) return;
+
+    float maxStep = rampRate > 0 ? rampRate * (now_ms - lastStep) / 1000.0f : INFINITY;
+    lastStep = now_ms;
+    bool changed = false;
+
+    portENTER_CRITICAL(&lock);
+    for (size_t i = 0; i < plants.size(); i++) {
+        Plant& p = plants[i];
+        float delta = targets[i] - p.setpoint;
+        if (delta >  maxStep) delta =  maxStep;
+        if (delta < -maxStep) delta = -maxStep;
+        p.setpoint += delta;
+        if (fabsf(p.setpoint - p.reported) > deadband) {
+            p.reported = p.setpoint;
+            changed = true;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (actuator) {
+        for (size_t i = 0; i < plants.size(); i++) actuator(plants[i].plant_id, plants[i].setpoint);
+    }
+    if (changed) api.notifyPlantsChanged();
+}
+
+float PowerController::setpoint(uint32_t plant_id) const {
+    float watts = NAN;
+    portENTER_CRITICAL(&lock);
+    for (const Plant& p : plants) {
+        if (p.plant_id == plant_id) { watts = p.setpoint; break; }
+    }
+    portEXIT_CRITICAL(&lock);
+    return watts;
+}
+
+size_t PowerController::readSetpoints(ConnectedPowerPlant* out, size_t max) const {
+    portENTER_CRITICAL(&lock);
+    size_t n = plants.size() < max ? plants.size() : max;
+    for (size_t i = 0; i < n; i++) {
+        out[i].plant_id  = plants[i].plant_id;
+        out[i].set_power = plants[i].setpoint;
+    }
+    portEXIT_CRITICAL(&lock);
+    return n;
+}
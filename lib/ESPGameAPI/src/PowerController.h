@@ -0,0 +1,79 @@
+#ifndef POWER_CONTROLLER_H
+#define POWER_CONTROLLER_H
+
+#include "ESPGameAPI.h"
+
+// Plants a controller drives, and its task's stack / priority
+#ifndef ESPGAMEAPI_MAX_PLANTS
+#define ESPGAMEAPI_MAX_PLANTS 8
+#endif
+#ifndef ESPGAMEAPI_CONTROLLER_STACK
+#define ESPGAMEAPI_CONTROLLER_STACK 3072
+#endif
+#ifndef ESPGAMEAPI_CONTROLLER_PRIORITY
+#define ESPGAMEAPI_CONTROLLER_PRIORITY 3
+#endif
+
+// Local setpoint engine for connected power plants ----------------------------
+// Each plant follows the production coefficient of its source: the target is
+// coefficient × share, clamped to the source's ProductionRange (when known),
+// and the setpoint ramps towards it at a fixed rate so actuation is smooth.
+// While the game is paused the targets are 0; a source without a coefficient
+// holds its setpoint. Steps read the lock-free snapshot only, never the
+// network. The controller installs itself as the API's plants source (and
+// removes itself when destroyed), sets the API's report deadband to its own
+// and calls notifyPlantsChanged() when a setpoint moved by more than the
+// deadband since the last report, so the server hears about real changes
+// without waiting for the update interval.
+class PowerController {
+public:
+    // Optional: drive the hardware from the controller task on every step
+    using Actuator = std::function<void(uint32_t plant_id, float watts)>;
+
+    explicit PowerController(ESPGameAPI& api);
+    ~PowerController();
+
+    // Call before begin(); false when ESPGAMEAPI_MAX_PLANTS are configured
+    bool addPlant(uint32_t plant_id, uint8_t source_id, float share = 1.0f);
+    void setRampRate(float wattsPerSecond) { rampRate = wattsPerSecond; }   // 0 = jump
+    void setDeadband(float watts)          { deadband = watts; api.setReportDeadband(watts); }
+    void setActuator(Actuator cb)          { actuator = cb; }
+
+    // Runs step() every periodMs on a task pinned to `core`
+    bool begin(uint32_t periodMs = 50, BaseType_t core = ESPGAMEAPI_APP_CORE);
+    void end();
+    bool running() const { return task != NULL; }
+    // Smallest free stack (bytes) the task has had, to size ESPGAMEAPI_CONTROLLER_STACK
+    uint32_t stackFree() const { return task ? (uint32_t)uxTaskGetStackHighWaterMark(task) : 0; }
+
+    // One control step (the task calls this; usable directly without begin())
+    void step(uint32_t now_ms);
+
+    float  setpoint(uint32_t plant_id) const;   // NAN if the plant is unknown
+    size_t readSetpoints(ConnectedPowerPlant* out, size_t max) const;
+
+private:
+    struct Plant {
+        uint32_t plant_id;
+        uint8_t  source_id;
+        float    share;
+        float    setpoint;
+        float    reported;     // value at the last notifyPlantsChanged()
+    };
+
+    ESPGameAPI& api;
+    FixedList<Plant, ESPGAMEAPI_MAX_PLANTS> plants;
+    ConnectedPowerPlant reported[ESPGAMEAPI_MAX_PLANTS];   // handed to the API as its plants source
+    float    rampRate = 0.0f;
+    float    deadband = 0.1f;    // W
+    Actuator actuator;
+    uint32_t periodMs = 50;
+    uint32_t lastStep = 0;
+    TaskHandle_t task = NULL;
+    mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    static void taskMain(void* arg);
+    float target(const Plant& p, const GameSnapshot& s) const;
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "WiFiLink.h"
+
+void WiFiLink::setStaticIP(IPAddress address, IPAddress gw, IPAddress mask, IPAddress dnsServer) {
+    staticIP = true;
+    ip = address;
+    gateway = gw;
+    subnet = mask;
+    dns = (uint32_t)dnsServer ? dnsServer : gw;
+}
+
+void WiFiLink::begin() {
+    if (eventId) return;
+    eventId = WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) { onEvent(event, info); });
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);   // reconnects are ours: direct attempt first
+    if (staticIP) WiFi.config(ip, gateway, subnet, dns);
+    GAME_LOG("📡 Connecting to WiFi: %s%s\n", ssid, staticIP ? " (static IP)" : "");
+    connectFull(millis());
+}
+
+void WiFiLink::end() {
+    if (!eventId) return;
+    WiFi.removeEvent(eventId);
+    eventId = 0;
+}
+
+// WiFi event task: record and return, the attempts start in update()
+void WiFiLink::onEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+            portENTER_CRITICAL(&lock);
+            memcpy(bssid, info.wifi_sta_connected.bssid, sizeof(bssid));
+            channel = info.wifi_sta_connected.channel;
+            haveAp = true;
+            portEXIT_CRITICAL(&lock);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            up = true;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            // The cached AP is gone (roamed away, powered off): scan next time
+            if (info.wifi_sta_disconnected.reason == WIFI_REASON_NO_AP_FOUND) haveAp = false;
+            // fall through
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            if (up) {
+                up = false;
+                AsyncRequest::dropConnections();
+            } else {
+                failed = true;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void WiFiLink::update() {
+    uint32_t now = millis();
+    if (up) {
+        if (!wasUp) {
+            wasUp = true;
+            if (dropCount) {
+                lastOutageMs = now - downSince;
+                GAME_LOG("📡 WiFi back after %u ms (%s)\n", (unsigned)lastOutageMs,
+                         phase == LINK_FAST ? "direct to the cached AP" : "full scan");
+            } else {
+                GAME_LOG("📡 WiFi connected, IP %s\n", WiFi.localIP().toString().c_str());
+            }
+            phase = LINK_UP;
+        }
+        return;
+    }
+
+    if (wasUp) {
+        wasUp = false;
+        downSince = now;
+        dropCount++;
+        GAME_LOG("📡 WiFi lost - reconnecting\n");
+        if (haveAp) connectFast(now);
+        else connectFull(now);
+        return;
+    }
+
+    uint32_t waited = now - attemptAt;
+    if (phase == LINK_FAST) {
+        if (!haveAp || now - downSince >= WIFILINK_FAST_TIMEOUT_MS) connectFull(now);
+        else if (failed && waited >= WIFILINK_FAST_RETRY_MS) connectFast(now);
+    } else if (phase == LINK_FULL) {
+        // One attempt at a time: a scan and DHCP can outlast retryMs
+        if (failed && waited >= retryMs) {
+            connectFull(now);
+        } else if (!failed && waited >= WIFILINK_ATTEMPT_TIMEOUT_MS) {
+            GAME_LOG("📡 WiFi attempt timed out - retrying\n");
+            WiFi.disconnect();
+            connectFull(now);
+        }
+    }
+}
+
+// Straight to the last AP: no scan, only association and (without a static
+// address) DHCP
+void WiFiLink::connectFast(uint32_t now) {
+    uint8_t ap[6];
+    portENTER_CRITICAL(&lock);
+    memcpy(ap, bssid, sizeof(ap));
+    int32_t ch = channel;
+    portEXIT_CRITICAL(&lock);
+    if (phase != LINK_FAST) {
+        GAME_LOG("📡 Direct reconnect to %02x:%02x:%02x:%02x:%02x:%02x, channel %d\n",
+                 ap[0], ap[1], ap[2], ap[3], ap[4], ap[5], (int)ch);
+    }
+    failed = false;
+    WiFi.begin(ssid, password, ch, ap);
+    phase = LINK_FAST;
+    attemptAt = now;
+}
+
+void WiFiLink::connectFull(uint32_t now) {
+    if (phase == LINK_FAST) {
+        GAME_LOG("📡 Cached AP not answering - scanning\n");
+        WiFi.disconnect();   // abandon the direct attempt
+    }
+    failed = false;
+    WiFi.begin(ssid, password);
+    phase = LINK_FULL;
+    attemptAt = now;
+}
+
+void WiFiLink::printStatus() const {
+    Serial.println("=== WiFi Link ===");
+    Serial.println("Link: " + String(up ? "up" : "down") + (up ? ", RSSI " + String(WiFi.RSSI()) + " dBm" : ""));
+    Serial.println("Drops: " + String(dropCount) + ", last outage " + String(lastOutageMs) + " ms");
+    Serial.println("Cached AP: " + String(haveAp ? "yes (channel " + String(channel) + ")" : "no"));
+    Serial.println("Address: " + String(staticIP ? "static" : "DHCP"));
+}
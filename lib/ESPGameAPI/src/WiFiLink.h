@@ -0,0 +1,82 @@
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include "ESPGameAPI.h"
+
+// Reconnect timing: direct (cached BSSID/channel) attempts are repeated,
+// WIFILINK_FAST_RETRY_MS apart after a failure, for WIFILINK_FAST_TIMEOUT_MS
+// after the drop; then full attempts follow, WIFILINK_RETRY_MS
+// (setRetryInterval()) after one failed or WIFILINK_ATTEMPT_TIMEOUT_MS after
+// one started without an IP
+#ifndef WIFILINK_FAST_TIMEOUT_MS
+#define WIFILINK_FAST_TIMEOUT_MS 3000
+#endif
+#ifndef WIFILINK_FAST_RETRY_MS
+#define WIFILINK_FAST_RETRY_MS 200
+#endif
+#ifndef WIFILINK_RETRY_MS
+#define WIFILINK_RETRY_MS 5000
+#endif
+#ifndef WIFILINK_ATTEMPT_TIMEOUT_MS
+#define WIFILINK_ATTEMPT_TIMEOUT_MS 15000
+#endif
+
+// Event-driven station link --------------------------------------------------
+// Subscribes to the WiFi events instead of polling WiFi.status(). On a drop it
+// closes AsyncRequest's sockets at once (they would only fail on their next
+// request) and reconnects straight to the last AP's BSSID and channel, which
+// skips the scan; if that AP is gone it falls back to a full connect. A
+// static address skips DHCP as well. Nothing blocks: the event handlers only
+// record what happened and update() (from loop()) starts the attempts.
+// ESPGameAPI opens its server connection ahead of the first request once the
+// link is back (AsyncRequest::prewarm()).
+class WiFiLink {
+public:
+    WiFiLink(const char* ssid, const char* password) : ssid(ssid), password(password) {}
+    ~WiFiLink() { end(); }
+
+    // Call before begin(); dns defaults to the gateway
+    void setStaticIP(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns = IPAddress());
+    void setRetryInterval(uint32_t ms) { retryMs = ms; }   // between full attempts
+
+    void begin();     // subscribes to the events and starts the first connect
+    void end();       // unsubscribes; the station stays as it is
+    void update();    // call from loop()
+
+    bool     connected()  const { return up; }
+    uint32_t drops()      const { return dropCount; }
+    uint32_t lastOutage() const { return lastOutageMs; }   // ms from drop to IP
+    void     printStatus() const;
+
+private:
+    enum Phase : uint8_t { LINK_UP, LINK_FAST, LINK_FULL };
+
+    void onEvent(arduino_event_id_t event, arduino_event_info_t info);
+    void connectFast(uint32_t now);
+    void connectFull(uint32_t now);
+
+    const char* ssid;
+    const char* password;
+    bool staticIP = false;
+    IPAddress ip, gateway, subnet, dns;
+
+    wifi_event_id_t eventId = 0;       // 0 = not subscribed
+
+    // Written by the WiFi event task, read by loop()
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    uint8_t  bssid[6] = {};
+    int32_t  channel = 0;
+    volatile bool haveAp = false;      // bssid/channel of the last association
+    volatile bool up = false;          // has an IP
+    volatile bool failed = false;      // an attempt ended without association
+
+    uint32_t retryMs = WIFILINK_RETRY_MS;
+    Phase    phase = LINK_FULL;
+    uint32_t attemptAt = 0;
+    uint32_t downSince = 0;
+    uint32_t dropCount = 0;
+    uint32_t lastOutageMs = 0;
+    bool     wasUp = false;
+};
+
+#endif
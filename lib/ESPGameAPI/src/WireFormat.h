@@ -0,0 +1,132 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+// Fixed-width binary frames ---------------------------------------------------
+// Every wire type has a Wire::Layout: its encoded size and load()/store()
+// between a buffer and the host value. Integers are big-endian. A record
+// (ProductionRangeEntry, PowerPlantEntry, ...) is described once as its
+// fields in frame order (Record + WIRE_FIELD); sizes and offsets are compile
+// time constants, so every record gets straight-line code. All buffer access
+// goes through memcpy, never an unaligned load or store, and the byte order
+// through the compiler's swap builtins. Reader checks lengths before every
+// read; append() grows the output buffer.
+namespace Wire {
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+inline uint16_t swap(uint16_t v) { return __builtin_bswap16(v); }
+inline uint32_t swap(uint32_t v) { return __builtin_bswap32(v); }
+#else
+inline uint16_t swap(uint16_t v) { return v; }
+inline uint32_t swap(uint32_t v) { return v; }
+#endif
+
+template <typename T> struct Layout;
+
+template <> struct Layout<uint8_t> {
+    static const size_t size = 1;
+    static void load(uint8_t& v, const uint8_t* p) { v = *p; }
+    static void store(uint8_t v, uint8_t* p) { *p = v; }
+};
+
+template <> struct Layout<uint16_t> {
+    static const size_t size = 2;
+    static void load(uint16_t& v, const uint8_t* p) { memcpy(&v, p, size); v = swap(v); }
+    static void store(uint16_t v, uint8_t* p) { v = swap(v); memcpy(p, &v, size); }
+};
+
+template <> struct Layout<uint32_t> {
+    static const size_t size = 4;
+    static void load(uint32_t& v, const uint8_t* p) { memcpy(&v, p, size); v = swap(v); }
+    static void store(uint32_t v, uint8_t* p) { v = swap(v); memcpy(p, &v, size); }
+};
+
+// Two's complement, same bytes as uint32_t (negative mW are valid)
+template <> struct Layout<int32_t> {
+    static const size_t size = 4;
+    static void load(int32_t& v, const uint8_t* p) { uint32_t u; Layout<uint32_t>::load(u, p); v = static_cast<int32_t>(u); }
+    static void store(int32_t v, uint8_t* p) { Layout<uint32_t>::store(static_cast<uint32_t>(v), p); }
+};
+
+// Member M of record S, encoded as its own type
+template <typename S, typename T, T S::*M>
+struct Field {
+    static const size_t size = Layout<T>::size;
+    static void load(S& s, const uint8_t* p) { Layout<T>::load(s.*M, p); }
+    static void store(const S& s, uint8_t* p) { Layout<T>::store(s.*M, p); }
+};
+#define WIRE_FIELD(S, member) ::Wire::Field<S, decltype(S::member), &S::member>
+
+// Fields back to back, no padding
+template <typename S, typename... F> struct Record;
+
+template <typename S> struct Record<S> {
+    static const size_t size = 0;
+    static void load(S&, const uint8_t*) {}
+    static void store(const S&, uint8_t*) {}
+};
+
+template <typename S, typename F, typename... Rest>
+struct Record<S, F, Rest...> {
+    typedef Record<S, Rest...> Tail;
+    static const size_t size = F::size + Tail::size;
+    static void load(S& s, const uint8_t* p) { F::load(s, p); Tail::load(s, p + F::size); }
+    static void store(const S& s, uint8_t* p) { F::store(s, p); Tail::store(s, p + F::size); }
+};
+
+// p must hold Layout<T>::size bytes
+template <typename T> inline void decode(T& v, const uint8_t* p) { Layout<T>::load(v, p); }
+
+template <typename T> inline void append(std::vector<uint8_t>& out, const T& v) {
+    size_t at = out.size();
+    out.resize(at + Layout<T>::size);
+    Layout<T>::store(v, &out[at]);
+}
+
+// [count u8] then count × T, all present
+template <typename T> inline bool listFits(const uint8_t* data, size_t len) {
+    return len >= 1 && len - 1 >= data[0] * Layout<T>::size;
+}
+
+// Cursor over a received frame; a read that does not fit fails and leaves
+// the position unchanged
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t len) : p(data), left(len) {}
+
+    template <typename T> bool read(T& v) {
+        if (left < Layout<T>::size) return false;
+        Layout<T>::load(v, p);
+        p += Layout<T>::size;
+        left -= Layout<T>::size;
+        return true;
+    }
+    // Reads a u8 count only if count × T follow
+    template <typename T> bool list(uint8_t& count) {
+        if (!listFits<T>(p, left)) return false;
+        count = *p++;
+        left--;
+        return true;
+    }
+    bool skip(size_t n) {
+        if (left < n) return false;
+        p += n;
+        left -= n;
+        return true;
+    }
+
+    const uint8_t* pos() const { return p; }
+    size_t remaining() const { return left; }
+
+private:
+    const uint8_t* p;
+    size_t left;
+};
+
+}  // namespace Wire
+
+#endif
@@ -2,10 +2,14 @@
 #include <time.h>
 #include "ESPGameAPI.h"
 #include "config.h"
+#include "WiFiLink.h"
 
 // Create API instance using config values (removed BOARD_ID parameter)
 ESPGameAPI gameAPI(SERVER_URL, BOARD_NAME, BOARD_TYPE);
 
+// Station link: event driven, reconnects straight to the last AP
+WiFiLink wifiLink(WIFI_SSID, WIFI_PASSWORD);
+
 // Simulation variables
 bool gameRunning = false;
 unsigned long lastStatusPrint = 0;
@@ -15,7 +19,7 @@ std::vector<ConnectedPowerPlant> connectedPowerPlants;
 std::vector<ConnectedConsumer> connectedConsumers;
 
 // Callback functions for the API
-float getProductionValue() {
+float productionFor(BoardType type) {
     // Calculate production based on board type
     float basePower = 0.0;
     float variation = 0.0;
@@ -23,7 +27,7 @@ float getProductionValue() {
     // Simple day/night simulation based on time
     bool isDayTime = (millis() / 10000) % 2 == 0;  // Simple 10s day/night cycle
     
-    switch (BOARD_TYPE) {
+    switch (type) {
         case BOARD_SOLAR:
             if (!isDayTime) {
                 return 0.0; // No solar power at night
@@ -52,6 +56,10 @@ float getProductionValue() {
     return basePower * (1.0 + variation);
 }
 
+float getProductionValue() {
+    return productionFor(BOARD_TYPE);
+}
+
 float getConsumptionValue() {
     // Simple day/night simulation based on time
     bool isDayTime = (millis() / 10000) % 2 == 0;  // Simple 10s day/night cycle
@@ -61,8 +69,8 @@ float getConsumptionValue() {
     return basePower * (1.0 + variation);
 }
 
-std::vector<ConnectedPowerPlant> getConnectedPowerPlants() {
-    // Return current connected power plants
+// Views of the lists above: the library reads them in place, no vector copy per tick
+ItemView<ConnectedPowerPlant> getConnectedPowerPlants() {
     // Update their set power values dynamically
     for (auto& plant : connectedPowerPlants) {
         plant.set_power = random(500, 2000) / 1000.0;  // Random power between 0.5-2.0W
@@ -70,11 +78,73 @@ std::vector<ConnectedPowerPlant> getConnectedPowerPlants() {
     return connectedPowerPlants;
 }
 
-std::vector<ConnectedConsumer> getConnectedConsumers() {
-    // Return current connected consumers
+ItemView<ConnectedConsumer> getConnectedConsumers() {
     return connectedConsumers;
 }
 
+#if SIM_BOARDS > 1
+// Multi-board simulation: boards 2..SIM_BOARDS run as virtual boards next to
+// gameAPI. Each has its own login and registration but shares gameAPI's game
+// state and the AsyncRequest connections; their device lists live here and
+// are handed over as views, so the steady state allocates nothing.
+struct VirtualBoard {
+    ESPGameAPI* api;
+    BoardType type;
+    ConnectedPowerPlant plants[2];
+    ConnectedConsumer consumers[2];
+    unsigned long connectAt;   // staggered so the logins don't arrive at once
+    bool connecting;
+};
+VirtualBoard fleet[SIM_BOARDS - 1];
+
+void setupFleet() {
+    static const BoardType types[] = { BOARD_SOLAR, BOARD_WIND, BOARD_BATTERY, BOARD_GENERIC };
+    for (int i = 0; i < SIM_BOARDS - 1; i++) {
+        VirtualBoard& vb = fleet[i];
+        uint32_t board = i + 2;   // gameAPI is board 1
+        vb.type = types[board % 4];
+        vb.api = new ESPGameAPI(gameAPI, String(BOARD_NAME) + "-" + String(board), vb.type);
+        vb.plants[0] = { 1000 * board + 1, 1.5f };
+        vb.plants[1] = { 1000 * board + 2, 2.0f };
+        vb.consumers[0] = { 1000 * board + 501 };
+        vb.consumers[1] = { 1000 * board + 502 };
+        vb.connectAt = millis() + (unsigned long)(i + 1) * SIM_STAGGER_MS;
+        vb.connecting = false;
+        
+        VirtualBoard* self = &vb;
+        vb.api->setProductionCallback([self]() { return productionFor(self->type); });
+        vb.api->setConsumptionCallback(getConsumptionValue);
+        vb.api->setPowerPlantsSource([self]() {
+            for (auto& plant : self->plants) plant.set_power = random(500, 2000) / 1000.0;
+            return ItemView<ConnectedPowerPlant>(self->plants, 2);
+        });
+        vb.api->setConsumersSource([self]() { return ItemView<ConnectedConsumer>(self->consumers, 2); });
+        vb.api->setAdaptiveIntervals(true);   // jittered gaps keep the boards apart
+    }
+    Serial.println("🛰️ Simulating " + String(SIM_BOARDS) + " boards, free heap: " + String(ESP.getFreeHeap()));
+}
+
+void updateFleet() {
+    unsigned long now = millis();
+    for (auto& vb : fleet) {
+        if (!vb.connecting && (long)(now - vb.connectAt) >= 0) {
+            char user[32];
+            snprintf(user, sizeof(user), SIM_USERNAME_FORMAT, (unsigned)(&vb - fleet + 2));
+            vb.api->connect(user, API_PASSWORD);
+            vb.connecting = true;
+        }
+        vb.api->update();
+    }
+}
+
+void printFleetStatus() {
+    int online = gameAPI.getConnectionState() == CONN_ONLINE;
+    for (auto& vb : fleet) online += vb.api->getConnectionState() == CONN_ONLINE;
+    Serial.println("🛰️ Boards online: " + String(online) + "/" + String(SIM_BOARDS) +
+                   ", free heap: " + String(ESP.getFreeHeap()));
+}
+#endif
+
 void setup() {
     // Initialize Serial with longer delay for ESP32-S3
     Serial.begin(115200);
@@ -97,6 +167,11 @@ void setup() {
     // Initialize random seed with ESP32 hardware RNG
     randomSeed(esp_random());
     
+#if SIM_BOARDS > 1
+    // Room in the shared request queue for every board's poll and reports
+    AsyncRequest::configure(ASYNCREQUEST_MAX_WORKERS, true, SIM_BOARDS * 3 < 255 ? SIM_BOARDS * 3 : 255);
+#endif
+    
     // Setup simulated connected devices
     // Add some power plants
     connectedPowerPlants.push_back({1001, 1.5});  // Power plant ID 1001, 1.5W
@@ -113,75 +188,39 @@ void setup() {
     // Setup callbacks
     gameAPI.setProductionCallback(getProductionValue);
     gameAPI.setConsumptionCallback(getConsumptionValue);
-    gameAPI.setPowerPlantsCallback(getConnectedPowerPlants);
-    gameAPI.setConsumersCallback(getConnectedConsumers);
+    gameAPI.setPowerPlantsSource(getConnectedPowerPlants);
+    gameAPI.setConsumersSource(getConnectedConsumers);
     
     // Configure update intervals
     gameAPI.setUpdateInterval(3000);  // Update every 3 seconds
     gameAPI.setPollInterval(5000);    // Poll every 5 seconds
     
-    // Connect to WiFi
-    Serial.println("📡 Connecting to WiFi: " + String(WIFI_SSID));
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    
-    unsigned long wifiStartTime = millis();
-    while (WiFi.status() != WL_CONNECTED && (millis() - wifiStartTime) < WIFI_TIMEOUT_MS) {
-        delay(1000);
-        Serial.print(".");
-    }
-    
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("\n❌ WiFi connection failed! Check credentials and try again.");
-        Serial.println("SSID: " + String(WIFI_SSID));
-        return;
-    }
+    // Report connection progress; the pipeline itself runs inside update()
+    gameAPI.setConnectionStateCallback([](ConnectionState state) {
+        if (state == CONN_ONLINE) {
+            Serial.println("✅ Board online!");
+            gameAPI.printStatus();
+            gameAPI.printTaskStatus();
+        }
+    });
     
-    Serial.println();
-    Serial.println("✅ WiFi connected!");
-    Serial.println("IP address: " + WiFi.localIP().toString());
-    Serial.println("Signal strength: " + String(WiFi.RSSI()) + " dBm");
+    // Connect to WiFi (non-blocking - update() waits for the link)
+    Serial.println("📡 Connecting to WiFi: " + String(WIFI_SSID));
+#ifdef WIFI_STATIC_IP
+    wifiLink.setStaticIP(IPAddress(WIFI_STATIC_IP), IPAddress(WIFI_STATIC_GATEWAY), IPAddress(WIFI_STATIC_SUBNET));
+#endif
+    wifiLink.setRetryInterval(RECONNECT_DELAY_MS);
+    wifiLink.begin();
     
-    // Configure time (for debugging purposes)
+    // Configure time (for debugging purposes); syncs in the background
     configTime(0, 0, "pool.ntp.org");
-    Serial.println("⏰ Configuring time...");
-    
-    struct tm timeinfo;
-    int timeAttempts = 0;
-    while (!getLocalTime(&timeinfo) && timeAttempts < 10) {
-        delay(1000);
-        Serial.print(".");
-        timeAttempts++;
-    }
-    
-    if (timeAttempts >= 10) {
-        Serial.println("\n⚠️ Time configuration failed, but continuing...");
-    } else {
-        Serial.println("\n✅ Time configured!");
-    }
     
-    // Login to the game
-    Serial.println("🔐 Logging in to server: " + String(SERVER_URL));
-    if (gameAPI.login(API_USERNAME, API_PASSWORD)) {
-        Serial.println("✅ Login successful!");
-        
-        // Register the board
-        Serial.println("📋 Registering board...");
-        if (gameAPI.registerBoard()) {
-            Serial.println("✅ Board registered successfully!");
-            Serial.println();
-            
-            // Print initial status
-            gameAPI.printStatus();
-            Serial.println();
-        } else {
-            Serial.println("❌ Board registration failed!");
-            return;
-        }
-    } else {
-        Serial.println("❌ Login failed!");
-        Serial.println("Check username/password and server URL");
-        return;
-    }
+    // WiFi → login → register → first poll, advanced by gameAPI.update()
+    Serial.println("🔐 Connecting to server: " + String(SERVER_URL));
+    gameAPI.connect(API_USERNAME, API_PASSWORD);
+#if SIM_BOARDS > 1
+    setupFleet();
+#endif
     
     Serial.println("\n⏳ Starting automatic updates...");
     Serial.println("The board will now poll for game status and submit data automatically.");
@@ -189,16 +228,14 @@ void setup() {
 }
 
 void loop() {
-    // Check WiFi connection
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("❌ WiFi disconnected! Reconnecting...");
-        WiFi.reconnect();
-        delay(RECONNECT_DELAY_MS);
-        return;
-    }
+    // Reconnects after a drop (gameAPI.update() resumes the session once it is back)
+    wifiLink.update();
     
-    // Call the main update function - this handles all the polling and data submission
+    // Call the main update function - this handles connecting, polling and data submission
     bool updated = gameAPI.update();
+#if SIM_BOARDS > 1
+    updateFleet();
+#endif
     
     unsigned long currentTime = millis();
     
@@ -232,6 +269,12 @@ void loop() {
         } else {
             Serial.println("⏳ Waiting for game to start...");
         }
+        if (wifiLink.drops()) {
+            Serial.println("📡 WiFi drops: " + String(wifiLink.drops()) + ", last outage " + String(wifiLink.lastOutage()) + " ms");
+        }
+#if SIM_BOARDS > 1
+        printFleetStatus();
+#endif
     }
     
     delay(100); // Small delay to prevent busy waiting